@@ -0,0 +1,408 @@
+#include "binary_feed.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+
+const char test_ns::binary_feed_magic[8] = {
+    'M', 'D', 'F', 'E', 'E', 'D', '\0', '\0'
+};
+
+/*
+ *
+ */
+test_ns::binary_feed_writer::binary_feed_writer()
+    : file(nullptr), record_count(0) {
+}
+
+/*
+ *
+ */
+test_ns::binary_feed_writer::~binary_feed_writer() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+/*
+ * The header is rewritten by close() once the sizes are known.
+ */
+bool test_ns::binary_feed_writer::open(const std::string& file_name) {
+    file = std::fopen(file_name.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+    binary_feed_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    return std::fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+/*
+ *
+ */
+bool test_ns::binary_feed_writer::write(const command_args_t& command) {
+    binary_record_t record;
+    return make_record(command, &record) && write_record(record);
+}
+
+/*
+ * command is the one parsed from line. line is kept if it is not the CSV
+ * form of command.
+ */
+bool test_ns::binary_feed_writer::write(const command_args_t& command,
+        const str_view_t& line) {
+    binary_record_t record;
+    if (!make_record(command, &record)) {
+        return false;
+    }
+    if (feed_handler::format_command(command) != line.to_string()) {
+        record.flags = binary_record_line;
+        lines.push_back(intern(line));
+    }
+    return write_record(record);
+}
+
+/*
+ *
+ */
+bool test_ns::binary_feed_writer::make_record(const command_args_t& command,
+        binary_record_t* out) {
+    binary_record_t& record = *out;
+    std::memset(&record, 0, sizeof(record));
+    record.command = static_cast<uint8_t>(command.command);
+    switch (command.command) {
+    case command_t::order_add:
+        record.side = static_cast<uint8_t>(command.side);
+        record.string = intern(command.symbol);
+        record.id = command.id;
+        record.quantity = command.quantity;
+        record.price = command.price;
+        break;
+    case command_t::order_modify:
+        record.id = command.id;
+        record.quantity = command.quantity;
+        record.price = command.price;
+        break;
+    case command_t::order_cancel:
+        record.id = command.id;
+        break;
+    case command_t::subs_vwap:
+    case command_t::unsubs_vwap:
+        record.string = intern(command.symbol);
+        record.quantity = command.quantity;
+        break;
+    case command_t::subs_bbo:
+    case command_t::unsubs_bbo:
+    case command_t::print:
+    case command_t::print_full:
+        record.string = intern(command.symbol);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+/*
+ *
+ */
+bool test_ns::binary_feed_writer::write_raw(const str_view_t& line) {
+    binary_record_t record;
+    std::memset(&record, 0, sizeof(record));
+    record.command = static_cast<uint8_t>(command_t::none);
+    record.string = intern(line);
+    return write_record(record);
+}
+
+/*
+ *
+ */
+bool test_ns::binary_feed_writer::write_record(const binary_record_t& record) {
+    if (file == nullptr ||
+            std::fwrite(&record, sizeof(record), 1, file) != 1) {
+        return false;
+    }
+    ++record_count;
+    return true;
+}
+
+/*
+ *
+ */
+uint32_t test_ns::binary_feed_writer::intern(const str_view_t& s) {
+    auto res = string_ids.insert(std::make_pair(s.to_string(),
+            static_cast<uint32_t>(strings.size())));
+    if (res.second) {
+        strings.push_back(&res.first->first);
+    }
+    return res.first->second;
+}
+
+/*
+ * Appends the string table and the lines section and writes the final
+ * header.
+ */
+bool test_ns::binary_feed_writer::close() {
+    if (file == nullptr) {
+        return false;
+    }
+    binary_feed_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, binary_feed_magic, sizeof(header.magic));
+    header.version = binary_feed_version;
+    header.record_size = sizeof(binary_record_t);
+    header.record_count = record_count;
+    header.records_offset = sizeof(header);
+    header.string_count = strings.size();
+    header.strings_offset = sizeof(header) +
+            record_count * sizeof(binary_record_t);
+    header.price_decimals = price_decimals;
+    header.line_count = lines.size();
+    header.lines_offset = header.strings_offset;
+
+    bool ok = true;
+    for (auto s : strings) {
+        uint32_t size = s->size();
+        ok = ok && std::fwrite(&size, sizeof(size), 1, file) == 1;
+        ok = ok && std::fwrite(s->data(), 1, size, file) == size;
+        header.lines_offset += sizeof(size) + size;
+    }
+    ok = ok && (lines.empty() || std::fwrite(lines.data(), sizeof(uint32_t),
+            lines.size(), file) == lines.size());
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0;
+    ok = ok && std::fwrite(&header, sizeof(header), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+/*
+ *
+ */
+uint64_t test_ns::binary_feed_writer::get_record_count() const {
+    return record_count;
+}
+
+/*
+ *
+ */
+test_ns::binary_feed_reader::binary_feed_reader()
+    : map(nullptr), map_size(0), records(nullptr), record_count(0),
+      position(0), lines(nullptr), line_count(0), line_position(0),
+      corrupt(false) {
+}
+
+/*
+ *
+ */
+test_ns::binary_feed_reader::~binary_feed_reader() {
+    close();
+}
+
+/*
+ *
+ */
+bool test_ns::binary_feed_reader::open(const std::string& file) {
+    close();
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+            static_cast<size_t>(st.st_size) < sizeof(binary_feed_header_t)) {
+        ::close(fd);
+        return false;
+    }
+    void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    map = static_cast<char*>(addr);
+    map_size = st.st_size;
+
+    binary_feed_header_t header;
+    std::memcpy(&header, map, sizeof(header));
+    if (!load(header)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Validates the header and indexes the string table.
+ */
+bool test_ns::binary_feed_reader::load(const binary_feed_header_t& header) {
+    if (std::memcmp(header.magic, binary_feed_magic,
+                sizeof(header.magic)) != 0 ||
+            header.version != binary_feed_version ||
+            header.record_size != sizeof(binary_record_t) ||
+            header.price_decimals != price_decimals ||
+            header.records_offset % alignof(binary_record_t) != 0 ||
+            header.records_offset > map_size ||
+            header.record_count > (map_size - header.records_offset) /
+                    sizeof(binary_record_t) ||
+            header.strings_offset > map_size ||
+            header.string_count > (map_size - header.strings_offset) /
+                    sizeof(uint32_t) ||
+            header.lines_offset > map_size ||
+            header.line_count > (map_size - header.lines_offset) /
+                    sizeof(uint32_t)) {
+        return false;
+    }
+    records = reinterpret_cast<const binary_record_t*>(
+            map + header.records_offset);
+    record_count = header.record_count;
+    lines = map + header.lines_offset;
+    line_count = header.line_count;
+
+    const char* p = map + header.strings_offset;
+    const char* end = map + map_size;
+    strings.reserve(header.string_count);
+    for (uint64_t i = 0; i < header.string_count; ++i) {
+        uint32_t size;
+        if (static_cast<size_t>(end - p) < sizeof(size)) {
+            return false;
+        }
+        std::memcpy(&size, p, sizeof(size));
+        p += sizeof(size);
+        if (static_cast<size_t>(end - p) < size) {
+            return false;
+        }
+        strings.push_back(str_view_t(p, size));
+        p += size;
+    }
+    return true;
+}
+
+/*
+ *
+ */
+void test_ns::binary_feed_reader::close() {
+    if (map != nullptr) {
+        ::munmap(map, map_size);
+    }
+    map = nullptr;
+    map_size = 0;
+    records = nullptr;
+    record_count = 0;
+    position = 0;
+    lines = nullptr;
+    line_count = 0;
+    line_position = 0;
+    corrupt = false;
+    strings.clear();
+    symbol_ids.clear();
+}
+
+/*
+ * Decodes the next record. A line that has to go through the CSV parser
+ * is returned in raw_line with command->command set to command_t::none.
+ * For another command, raw_line is the source line if it was kept, so
+ * that errors can quote it, or empty. Returns false at the end of the
+ * feed or at a malformed record.
+ */
+bool test_ns::binary_feed_reader::next(command_args_t* command,
+        str_view_t* raw_line) {
+    if (position >= record_count) {
+        return false;
+    }
+    const binary_record_t& record = records[position];
+    auto a_command = static_cast<command_t>(record.command);
+    bool uses_string = a_command != command_t::order_modify &&
+            a_command != command_t::order_cancel;
+    uint32_t line = 0;
+    bool has_line = record.flags == binary_record_line &&
+            a_command != command_t::none;
+    if (has_line && line_position < line_count) {
+        std::memcpy(&line, lines + line_position * sizeof(line),
+                sizeof(line));
+    }
+    if (record.command > static_cast<uint8_t>(command_t::print_full) ||
+            record.side > static_cast<uint8_t>(side_t::sell) ||
+            (uses_string && record.string >= strings.size()) ||
+            (record.flags != 0 && !has_line) ||
+            (has_line && (line_position == line_count ||
+                line >= strings.size()))) {
+        corrupt = true;
+        return false;
+    }
+    ++position;
+    if (has_line) {
+        ++line_position;
+    }
+    command->command = a_command;
+    command->id = record.id;
+    command->symbol = uses_string ? strings[record.string] : str_view_t();
+    command->side = static_cast<side_t>(record.side);
+    command->quantity = record.quantity;
+    command->price = record.price;
+    if (a_command == command_t::none) {
+        *raw_line = command->symbol;
+    } else {
+        *raw_line = has_line ? strings[line] : str_view_t();
+    }
+    return true;
+}
+
+/*
+ * next() as a record for handler, so that the records are applied with
+ * no text at all. Symbols are resolved as feed_handler::to_record()
+ * resolves them: an unsubscription or a print only looks its symbol up,
+ * and an unknown one is looked up again next time. Each string of the
+ * feed is resolved once otherwise, the same feed_handler has to be
+ * passed on every call.
+ */
+bool test_ns::binary_feed_reader::next(feed_handler* handler,
+        command_record_t* record, str_view_t* raw_line) {
+    command_args_t command;
+    if (!next(&command, raw_line)) {
+        return false;
+    }
+    *record = command_record_t{command.id, command.quantity, command.price,
+        no_symbol, command.command, command.side};
+    bool lookup_only = false;
+    switch (command.command) {
+    case command_t::none:
+    case command_t::order_modify:
+    case command_t::order_cancel:
+        return true;
+    case command_t::unsubs_bbo:
+    case command_t::unsubs_vwap:
+    case command_t::print:
+    case command_t::print_full:
+        lookup_only = true;
+        break;
+    default:
+        break;
+    }
+    if (symbol_ids.empty()) {
+        symbol_ids.assign(strings.size(), no_symbol);
+    }
+    auto & symbol = symbol_ids[records[position - 1].string];
+    if (symbol == no_symbol) {
+        symbol = lookup_only ? handler->find_symbol(command.symbol) :
+                handler->intern_symbol(command.symbol);
+    }
+    record->symbol = symbol;
+    return true;
+}
+
+/*
+ *
+ */
+bool test_ns::binary_feed_reader::is_corrupt() const {
+    return corrupt;
+}
+
+/*
+ *
+ */
+uint64_t test_ns::binary_feed_reader::get_record_count() const {
+    return record_count;
+}
@@ -0,0 +1,136 @@
+#ifndef BINARY_FEED_H
+#define BINARY_FEED_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "feed_handler.h"
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Binary feed file, written by md_convert and replayed by
+ * md_replay --binary. All integers are in host byte order.
+ *
+ *   offset 0               binary_feed_header_t
+ *   records_offset         record_count x binary_record_t
+ *   strings_offset         string_count x { uint32_t size; char[size] }
+ *   lines_offset           line_count x uint32_t string index
+ *
+ * Every CSV line becomes exactly one record. Symbols are stored once in
+ * the string table and records refer to them by index. A line which
+ * does not decode into a valid command is stored verbatim in the string
+ * table and referenced from a record with command_t::none; it is
+ * replayed through the CSV parser so that its error and side effects
+ * are the same as in the text feed. A valid line which differs from
+ * the CSV form of its command, such as "10." for the price 10, is
+ * also stored in the string table. Its record has binary_record_line
+ * set and takes the next index of the lines section, so that errors
+ * quote the line as in the text feed. Prices are stored in ticks, so a
+ * feed can only be replayed by a build with the same PRICE_DECIMALS.
+ */
+struct binary_feed_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t record_count;
+    uint64_t records_offset;
+    uint64_t string_count;
+    uint64_t strings_offset;
+    uint32_t price_decimals;    // PRICE_DECIMALS of the writer
+    uint32_t reserved;
+    uint64_t line_count;
+    uint64_t lines_offset;
+};
+
+/*
+ * One command. Fields not used by the command are zero.
+ */
+struct binary_record_t {
+    uint8_t command;    // command_t
+    uint8_t side;       // side_t
+    uint16_t flags;     // binary_record_line or 0
+    uint32_t string;    // symbol, or the raw line for command_t::none
+    uint64_t id;
+    uint64_t quantity;
+    int64_t price;      // price_t ticks
+};
+
+static_assert(sizeof(binary_record_t) == 32,
+        "binary_record_t must be 32 bytes");
+
+// the source line of the record is in the lines section
+const uint16_t binary_record_line = 1;
+
+/*
+ *
+ */
+class binary_feed_writer {
+ public:
+    binary_feed_writer();
+    ~binary_feed_writer();
+    binary_feed_writer(const binary_feed_writer&) = delete;
+    binary_feed_writer& operator=(const binary_feed_writer&) = delete;
+
+    bool open(const std::string& file);
+    bool write(const command_args_t& command);
+    bool write(const command_args_t& command, const str_view_t& line);
+    bool write_raw(const str_view_t& line);
+    bool close();
+    uint64_t get_record_count() const;
+
+ private:
+    std::FILE* file;
+    uint64_t record_count;
+    std::unordered_map<std::string, uint32_t> string_ids;
+    std::vector<const std::string*> strings;
+    // string indexes of the lines section
+    std::vector<uint32_t> lines;
+    uint32_t intern(const str_view_t&);
+    bool make_record(const command_args_t&, binary_record_t*);
+    bool write_record(const binary_record_t&);
+};
+
+/*
+ *
+ */
+class binary_feed_reader {
+ public:
+    binary_feed_reader();
+    ~binary_feed_reader();
+    binary_feed_reader(const binary_feed_reader&) = delete;
+    binary_feed_reader& operator=(const binary_feed_reader&) = delete;
+
+    bool open(const std::string& file);
+    void close();
+    bool next(command_args_t* command, str_view_t* raw_line);
+    bool next(feed_handler*, command_record_t*, str_view_t* raw_line);
+    bool is_corrupt() const;
+    uint64_t get_record_count() const;
+
+ private:
+    char* map;
+    size_t map_size;
+    const binary_record_t* records;
+    uint64_t record_count;
+    uint64_t position;
+    const char* lines;
+    uint64_t line_count;
+    uint64_t line_position;
+    bool corrupt;
+    std::vector<str_view_t> strings;
+    // symbol ids of the strings in the feed_handler passed to next()
+    std::vector<symbol_id_t> symbol_ids;
+    bool load(const binary_feed_header_t&);
+};
+
+extern const char binary_feed_magic[8];
+const uint32_t binary_feed_version = 3;
+
+}  // namespace test_ns
+
+#endif  // BINARY_FEED_H
@@ -0,0 +1,270 @@
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "binary_feed.h"
+#include "feed_handler.h"
+#include "unittest_util.h"
+
+namespace {
+
+using test_ns::unittest::temp_file_t;
+
+/*
+ *
+ */
+struct output_t {
+    std::vector<std::string> lines;
+    std::vector<std::pair<std::string, std::string>> errors;
+};
+
+test_ns::feed_handler make_handler(const std::string& symbol,
+        output_t* output) {
+    return test_ns::feed_handler(symbol,
+            [output](const std::string& s) {
+                output->lines.push_back(s);
+            },
+            [output](const std::string& line, const std::string& err) {
+                output->errors.push_back(std::make_pair(line, err));
+            });
+}
+
+void convert(const std::vector<std::string>& lines,
+        const std::string& file) {
+    test_ns::binary_feed_writer writer;
+    ASSERT_TRUE(writer.open(file));
+    for (auto const & line : lines) {
+        test_ns::command_args_t command;
+        if (test_ns::feed_handler::parse_command(line,
+                    test_ns::str_view_t(), &command) == nullptr) {
+            ASSERT_TRUE(writer.write(command, line));
+        } else {
+            ASSERT_TRUE(writer.write_raw(line));
+        }
+    }
+    ASSERT_EQ(writer.get_record_count(), lines.size());
+    ASSERT_TRUE(writer.close());
+}
+
+void replay(const std::string& file, test_ns::feed_handler* handler) {
+    test_ns::binary_feed_reader reader;
+    ASSERT_TRUE(reader.open(file));
+    test_ns::command_args_t command;
+    test_ns::str_view_t raw_line;
+    while (reader.next(&command, &raw_line)) {
+        if (command.command == test_ns::command_t::none) {
+            handler->process_command(raw_line);
+        } else if (raw_line.empty()) {
+            handler->process_command(command);
+        } else {
+            handler->process_command(command, raw_line);
+        }
+    }
+    ASSERT_FALSE(reader.is_corrupt());
+}
+
+/*
+ * replay() through command records.
+ */
+void replay_records(const std::string& file,
+        test_ns::feed_handler* handler) {
+    test_ns::binary_feed_reader reader;
+    ASSERT_TRUE(reader.open(file));
+    test_ns::command_record_t record;
+    test_ns::str_view_t raw_line;
+    while (reader.next(handler, &record, &raw_line)) {
+        if (record.command == test_ns::command_t::none) {
+            handler->process_command(raw_line);
+        } else if (raw_line.empty()) {
+            handler->process(record);
+        } else {
+            handler->process(record, raw_line);
+        }
+    }
+    ASSERT_FALSE(reader.is_corrupt());
+}
+
+const std::vector<std::string> test_feed = {
+    "SUBSCRIBE BBO,S1",
+    "SUBSCRIBE VWAP,S1,15",
+    "SUBSCRIBE VWAP,S2,5",
+    "ORDER ADD,1,S1,Buy,10,72.82",
+    "ORDER ADD,2,S1,Buy,100,72.81",
+    "ORDER ADD,3,S1,Sell,20,72.85",
+    "ORDER ADD,4,S2,Sell,20,10.",
+    "ORDER ADD,5,S2,Hold,20,10.",
+    "ORDER ADD,3,S1,Sell,20,72.85",
+    "",
+    "ORDER MODIFY,2,50,72.8",
+    "ORDER MODIFY,9,50,72.8",
+    "PRINT,S1",
+    "PRINT_FULL,S2",
+    "ORDER CANCEL,1",
+    "ORDER CANCEL,1",
+    "UNSUBSCRIBE BBO,S1",
+    "UNSUBSCRIBE VWAP,S1,15",
+    "PRINT,S1,",
+    "PRINT,S1"
+};
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(BinaryFeed, SameOutputAsText) {
+    temp_file_t file;
+    convert(test_feed, file.name);
+    for (auto symbol : {"", "S1", "S2"}) {
+        output_t text_output, binary_output;
+        auto text_handler = make_handler(symbol, &text_output);
+        for (auto const & line : test_feed) {
+            text_handler.process_command(line);
+        }
+        auto binary_handler = make_handler(symbol, &binary_output);
+        replay(file.name, &binary_handler);
+        ASSERT_FALSE(text_output.lines.empty());
+        ASSERT_EQ(text_output.lines, binary_output.lines);
+        ASSERT_EQ(text_output.errors, binary_output.errors);
+    }
+}
+
+/*
+ *
+ */
+TEST(BinaryFeed, SameOutputAsRecords) {
+    temp_file_t file;
+    convert(test_feed, file.name);
+    for (auto symbol : {"", "S1", "S2"}) {
+        output_t command_output, record_output;
+        auto command_handler = make_handler(symbol, &command_output);
+        replay(file.name, &command_handler);
+        auto record_handler = make_handler(symbol, &record_output);
+        replay_records(file.name, &record_handler);
+        ASSERT_FALSE(command_output.lines.empty());
+        ASSERT_EQ(command_output.lines, record_output.lines);
+        ASSERT_EQ(command_output.errors, record_output.errors);
+    }
+}
+
+/*
+ * An error of a decoded command quotes its source line, which is only
+ * stored if it is not the CSV form of the command.
+ */
+TEST(BinaryFeed, ErrorLineOfDecodedCommand) {
+    const std::vector<std::string> lines = {"ORDER ADD,1,S1,Buy,20,3.33",
+        "ORDER ADD,1,S1,Sell,5,10.", "ORDER ADD,1,S1,Buy,10,100.1400",
+        "ORDER CANCEL,7"};
+    temp_file_t file;
+    convert(lines, file.name);
+    output_t output;
+    auto handler = make_handler("", &output);
+    replay(file.name, &handler);
+    ASSERT_EQ(output.errors.size(), 3);
+    ASSERT_EQ(output.errors[0].first, lines[1]);
+    ASSERT_EQ(output.errors[1].first, lines[2]);
+    ASSERT_EQ(output.errors[2].first, lines[3]);
+    output_t record_output;
+    auto record_handler = make_handler("", &record_output);
+    replay_records(file.name, &record_handler);
+    ASSERT_EQ(record_output.errors, output.errors);
+}
+
+/*
+ * Only lines which are not in CSV form are stored, each once.
+ */
+TEST(BinaryFeed, SourceLinesKeptOnlyIfNotCanonical) {
+    temp_file_t canonical, other;
+    convert({"ORDER ADD,1,S1,Buy,20,3.33", "PRINT,S1"}, canonical.name);
+    convert({"ORDER ADD,1,S1,Buy,20,3.330", "PRINT,S1"}, other.name);
+    FILE* f = fopen(canonical.name.c_str(), "rb");
+    ASSERT_TRUE(f != nullptr);
+    test_ns::binary_feed_header_t header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, f), 1);
+    fclose(f);
+    ASSERT_EQ(header.line_count, 0);
+    f = fopen(other.name.c_str(), "rb");
+    ASSERT_TRUE(f != nullptr);
+    ASSERT_EQ(fread(&header, sizeof(header), 1, f), 1);
+    fclose(f);
+    ASSERT_EQ(header.line_count, 1);
+    test_ns::binary_feed_reader reader;
+    ASSERT_TRUE(reader.open(other.name));
+    test_ns::command_args_t command;
+    test_ns::str_view_t raw_line;
+    ASSERT_TRUE(reader.next(&command, &raw_line));
+    ASSERT_EQ(raw_line.to_string(), "ORDER ADD,1,S1,Buy,20,3.330");
+    ASSERT_TRUE(reader.next(&command, &raw_line));
+    ASSERT_TRUE(raw_line.empty());
+    ASSERT_FALSE(reader.next(&command, &raw_line));
+    ASSERT_FALSE(reader.is_corrupt());
+}
+
+/*
+ * As with process_command(), an unsubscription or a print of an unknown
+ * symbol does not intern it, and the symbol is found once added.
+ */
+TEST(BinaryFeed, LookupOnlySymbols) {
+    const std::vector<std::string> lines = {"PRINT,S1",
+        "UNSUBSCRIBE BBO,S2", "PRINT_FULL,S3", "ORDER ADD,1,S1,Buy,10,1.5",
+        "PRINT,S1"};
+    temp_file_t file;
+    convert(lines, file.name);
+    output_t text_output, record_output;
+    auto text_handler = make_handler("", &text_output);
+    for (auto const & line : lines) {
+        text_handler.process_command(line);
+    }
+    auto record_handler = make_handler("", &record_output);
+    replay_records(file.name, &record_handler);
+    ASSERT_EQ(record_output.lines, text_output.lines);
+    ASSERT_EQ(record_output.errors, text_output.errors);
+    ASSERT_EQ(record_handler.find_symbol("S1"), 0);
+    ASSERT_EQ(record_handler.find_symbol("S2"), test_ns::no_symbol);
+    ASSERT_EQ(record_handler.find_symbol("S3"), test_ns::no_symbol);
+    ASSERT_EQ(text_handler.find_symbol("S2"), test_ns::no_symbol);
+}
+
+TEST(BinaryFeed, EmptyFeed) {
+    temp_file_t file;
+    convert({}, file.name);
+    test_ns::binary_feed_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    ASSERT_EQ(reader.get_record_count(), 0);
+    test_ns::command_args_t command;
+    test_ns::str_view_t raw_line;
+    ASSERT_FALSE(reader.next(&command, &raw_line));
+    ASSERT_FALSE(reader.is_corrupt());
+}
+
+TEST(BinaryFeed, NotABinaryFeed) {
+    temp_file_t file;
+    FILE* f = fopen(file.name.c_str(), "w");
+    ASSERT_TRUE(f != nullptr);
+    fputs("ORDER ADD,1,S1,Buy,20,3.33\nORDER ADD,1,S1,Buy,20,3.33\n"
+          "ORDER ADD,1,S1,Buy,20,3.33\n", f);
+    fclose(f);
+    test_ns::binary_feed_reader reader;
+    ASSERT_FALSE(reader.open(file.name));
+}
+
+/*
+ * A string count the file cannot hold is rejected before any string is
+ * read.
+ */
+TEST(BinaryFeed, BadStringCount) {
+    temp_file_t file;
+    convert(test_feed, file.name);
+    FILE* f = fopen(file.name.c_str(), "r+b");
+    ASSERT_TRUE(f != nullptr);
+    uint64_t string_count = uint64_t(1) << 61;
+    fseek(f, offsetof(test_ns::binary_feed_header_t, string_count), SEEK_SET);
+    fwrite(&string_count, sizeof(string_count), 1, f);
+    fclose(f);
+    test_ns::binary_feed_reader reader;
+    ASSERT_FALSE(reader.open(file.name));
+}
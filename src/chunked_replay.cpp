@@ -0,0 +1,174 @@
+#include "chunked_replay.h"
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <thread>
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+}  // namespace
+
+/*
+ * Chunks are chunk_size bytes or a bit more, up to the next line end.
+ * window is twice the parsers unless given.
+ */
+test_ns::
+chunked_replay::chunked_replay(unsigned a_parsers, size_t a_chunk_size,
+        size_t window)
+    : parsers(a_parsers == 0 ? 1 : a_parsers),
+      chunk_size(a_chunk_size == 0 ? 1 : a_chunk_size),
+      chunks(window == 0 ? 2 * parsers : window), text_begin(nullptr),
+      next_chunk(0), applied(0), running_seconds(0), waiting_seconds(0) {
+}
+
+/*
+ * Replays every line of reader. A file which is not mapped is replayed
+ * line by line on the calling thread.
+ */
+void test_ns::
+chunked_replay::run(line_reader* reader, feed_handler* handler) {
+    auto start = std::chrono::steady_clock::now();
+    str_view_t text = reader->take_unread();
+    if (text.empty()) {
+        str_view_t line;
+        while (reader->next_line(&line)) {
+            handler->process_command(line);
+        }
+        running_seconds += seconds_since(start);
+        return;
+    }
+    split(text);
+    selected_symbol = handler->get_selected_symbol();
+    next_chunk = applied = 0;
+    for (auto & chunk : chunks) {
+        chunk.parsed = false;
+    }
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i != parsers; ++i) {
+        threads.emplace_back(&chunked_replay::parse, this);
+    }
+    for (size_t i = 0; i != chunk_ends.size(); ++i) {
+        auto & chunk = chunks[i % chunks.size()];
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            if (!chunk.parsed) {
+                auto wait_start = std::chrono::steady_clock::now();
+                chunk_parsed.wait(guard, [&chunk] { return chunk.parsed; });
+                waiting_seconds += seconds_since(wait_start);
+            }
+        }
+        for (auto const & parsed : chunk.lines) {
+            handler->process_parsed(parsed);
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            chunk.parsed = false;
+            ++applied;
+        }
+        chunk_applied.notify_all();
+    }
+    for (auto & thread : threads) {
+        thread.join();
+    }
+    running_seconds += seconds_since(start);
+}
+
+/*
+ *
+ */
+uint64_t test_ns::
+chunked_replay::get_chunks_number() const {
+    return chunk_ends.size();
+}
+
+/*
+ *
+ */
+double test_ns::
+chunked_replay::get_applier_waiting_seconds() const {
+    return waiting_seconds;
+}
+
+/*
+ *
+ */
+void test_ns::
+chunked_replay::print_stats(std::ostream& out) const {
+    out << "chunks " << chunk_ends.size() << ", parsers " << parsers
+        << ", applier waited " << std::fixed << std::setprecision(3)
+        << waiting_seconds << " s of " << running_seconds << " s"
+        << std::endl;
+}
+
+/*
+ * A chunk ends just after a newline, or at the end of the text.
+ */
+void test_ns::
+chunked_replay::split(const str_view_t& text) {
+    text_begin = text.begin();
+    chunk_ends.clear();
+    const char* position = text.begin();
+    while (position != text.end()) {
+        if (static_cast<size_t>(text.end() - position) <= chunk_size) {
+            position = text.end();
+        } else {
+            position += chunk_size - 1;
+            auto eol = static_cast<const char*>(std::memchr(position, '\n',
+                    text.end() - position));
+            position = eol == nullptr ? text.end() : eol + 1;
+        }
+        chunk_ends.push_back(position);
+    }
+}
+
+/*
+ * Takes the next chunk while it is within the window of the applier.
+ */
+void test_ns::
+chunked_replay::parse() {
+    for (;;) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            chunk_applied.wait(guard, [this] {
+                return next_chunk == chunk_ends.size() ||
+                        next_chunk < applied + chunks.size();
+            });
+            if (next_chunk == chunk_ends.size()) {
+                return;
+            }
+            index = next_chunk++;
+        }
+        auto & chunk = chunks[index % chunks.size()];
+        parse_chunk(index, &chunk);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            chunk.parsed = true;
+        }
+        chunk_parsed.notify_one();
+    }
+}
+
+/*
+ * Splits lines as line_reader::next_line() does.
+ */
+void test_ns::
+chunked_replay::parse_chunk(size_t index, chunk_t* chunk) const {
+    const char* begin = index == 0 ? text_begin : chunk_ends[index - 1];
+    delimiter_scanner scanner;
+    scanner.reset(str_view_t(begin, chunk_ends[index] - begin));
+    chunk->lines.clear();
+    str_view_t line;
+    line_commas_t commas;
+    while (scanner.next_line(&line, &commas)) {
+        chunk->lines.emplace_back();
+        feed_handler::parse_line(line, commas, selected_symbol,
+                &chunk->lines.back());
+    }
+}
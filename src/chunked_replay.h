@@ -0,0 +1,74 @@
+#ifndef CHUNKED_REPLAY_H
+#define CHUNKED_REPLAY_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "feed_handler.h"
+#include "line_reader.h"
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Replays a memory mapped text feed with parsing spread over a pool of
+ * threads. The text is cut into chunks that end at a line end. The
+ * parsers take chunks in turn and decode their lines with
+ * feed_handler::parse_line(). The thread calling run() applies the
+ * chunks in file order, so the output is the one of
+ * feed_handler::process_command() on every line. Lines which are not
+ * valid commands are carried through in order and reported by the
+ * feed_handler as usual.
+ *
+ * Parsers run at most window chunks ahead of the applier, which bounds
+ * the memory taken by parsed lines whatever the size of the file.
+ */
+class chunked_replay {
+ public:
+    explicit chunked_replay(unsigned parsers, size_t chunk_size = 1 << 20,
+            size_t window = 0);
+    chunked_replay(const chunked_replay&) = delete;
+    chunked_replay& operator=(const chunked_replay&) = delete;
+
+    void run(line_reader*, feed_handler*);
+    uint64_t get_chunks_number() const;
+    /*
+     * Time the applier waited for a chunk to be parsed. A replay is
+     * bound by parsing as long as it is a large part of the replay.
+     */
+    double get_applier_waiting_seconds() const;
+    void print_stats(std::ostream&) const;
+
+ private:
+    struct chunk_t {
+        std::vector<parsed_line_t> lines;
+        bool parsed;
+    };
+
+    unsigned parsers;
+    size_t chunk_size;
+    std::vector<chunk_t> chunks;
+    // ends of the chunks of the text being replayed
+    std::vector<const char*> chunk_ends;
+    const char* text_begin;
+    symbol_t selected_symbol;
+    size_t next_chunk;
+    size_t applied;
+    std::mutex lock;
+    std::condition_variable chunk_parsed;
+    std::condition_variable chunk_applied;
+    double running_seconds;
+    double waiting_seconds;
+
+    void split(const str_view_t& text);
+    void parse();
+    void parse_chunk(size_t index, chunk_t*) const;
+};
+
+}  // namespace test_ns
+
+#endif  // CHUNKED_REPLAY_H
@@ -0,0 +1,140 @@
+#include <unistd.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "chunked_replay.h"
+#include "feed_handler.h"
+#include "line_reader.h"
+#include "unittest_util.h"
+
+namespace {
+
+using test_ns::unittest::make_err_callback;
+using test_ns::unittest::random_feed;
+using test_ns::unittest::replay;
+using test_ns::unittest::replay_result_t;
+using test_ns::unittest::temp_file_t;
+
+/*
+ *
+ */
+replay_result_t replay_chunked(test_ns::line_reader* reader,
+        const std::string& symbol, test_ns::chunked_replay* chunked) {
+    replay_result_t result;
+    test_ns::string_sink output(&result.output);
+    test_ns::feed_handler handler(symbol, &output,
+            make_err_callback(&result));
+    chunked->run(reader, &handler);
+    output.flush();
+    return result;
+}
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(ChunkedReplay, EmptyFile) {
+    temp_file_t file("");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    test_ns::chunked_replay chunked(2);
+    replay_result_t result = replay_chunked(&reader, "", &chunked);
+    ASSERT_TRUE(result.output.empty());
+    ASSERT_TRUE(result.errors.empty());
+    ASSERT_EQ(chunked.get_chunks_number(), 0);
+}
+
+/*
+ * The same output and errors as a replay line by line, whatever the
+ * number of parsers, the chunk size and the window.
+ */
+TEST(ChunkedReplay, SameAsProcessCommand) {
+    temp_file_t file(random_feed(1, 20000));
+    for (const char* symbol : {"", "S2"}) {
+        replay_result_t expected = replay(file.name, symbol);
+        ASSERT_FALSE(expected.output.empty());
+        ASSERT_FALSE(expected.errors.empty());
+        for (unsigned parsers : {1, 3}) {
+            for (size_t chunk_size : {1, 100, 1 << 20}) {
+                for (size_t window : {1, 0}) {
+                    test_ns::line_reader reader;
+                    ASSERT_TRUE(reader.open(file.name));
+                    test_ns::chunked_replay chunked(parsers, chunk_size,
+                            window);
+                    replay_result_t result =
+                            replay_chunked(&reader, symbol, &chunked);
+                    ASSERT_EQ(result.output, expected.output);
+                    ASSERT_EQ(result.errors, expected.errors);
+                }
+            }
+        }
+    }
+}
+
+/*
+ * The last line is replayed without a line end, chunks end at line ends.
+ */
+TEST(ChunkedReplay, NoTrailingNewline) {
+    std::string feed = random_feed(2, 1000) + "PRINT,S1";
+    temp_file_t file(feed);
+    replay_result_t expected = replay(file.name, "");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    test_ns::chunked_replay chunked(2, 1000);
+    replay_result_t result = replay_chunked(&reader, "", &chunked);
+    ASSERT_EQ(result.output, expected.output);
+    ASSERT_EQ(result.errors, expected.errors);
+    ASSERT_GT(chunked.get_chunks_number(), 1);
+    ASSERT_LE(chunked.get_chunks_number(), feed.size() / 1000 + 1);
+}
+
+/*
+ * Lines read through a pipe are replayed line by line.
+ */
+TEST(ChunkedReplay, Pipe) {
+    std::string feed = random_feed(3, 5000);
+    temp_file_t file(feed);
+    replay_result_t expected = replay(file.name, "");
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::thread writer([&]() {
+        size_t written = 0;
+        while (written < feed.size()) {
+            ssize_t n = write(fds[1], feed.data() + written,
+                    feed.size() - written);
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        close(fds[1]);
+    });
+    test_ns::line_reader reader;
+    reader.open_fd(fds[0]);
+    test_ns::chunked_replay chunked(2, 100);
+    replay_result_t result = replay_chunked(&reader, "", &chunked);
+    writer.join();
+    close(fds[0]);
+    ASSERT_EQ(result.output, expected.output);
+    ASSERT_EQ(result.errors, expected.errors);
+    ASSERT_EQ(chunked.get_chunks_number(), 0);
+}
+
+/*
+ *
+ */
+TEST(ChunkedReplay, Stats) {
+    temp_file_t file("PRINT,S1\nPRINT,S2\nPRINT,S3\n");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    test_ns::chunked_replay chunked(2, 9);
+    replay_chunked(&reader, "", &chunked);
+    ASSERT_EQ(chunked.get_chunks_number(), 3);
+    ASSERT_GE(chunked.get_applier_waiting_seconds(), 0);
+    std::ostringstream out;
+    chunked.print_stats(out);
+    ASSERT_NE(out.str().find("chunks 3, parsers 2"), std::string::npos);
+}
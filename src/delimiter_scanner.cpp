@@ -0,0 +1,285 @@
+#include "delimiter_scanner.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define DELIMITER_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+const size_t test_ns::delimiter_scanner::block_size;
+const unsigned test_ns::line_commas_t::max_size;
+
+/*
+ * SSE2 is part of x86-64, AVX2 is checked once at run time.
+ */
+test_ns::scan_isa_t test_ns::get_best_scan_isa() {
+#ifdef DELIMITER_SCANNER_X86
+    static const scan_isa_t best = __builtin_cpu_supports("avx2") ?
+            scan_isa_t::avx2 : scan_isa_t::sse2;
+    return best;
+#else
+    return scan_isa_t::scalar;
+#endif
+}
+
+/*
+ *
+ */
+bool test_ns::is_scan_isa_supported(scan_isa_t isa) {
+    return static_cast<unsigned>(isa) <=
+            static_cast<unsigned>(get_best_scan_isa());
+}
+
+/*
+ *
+ */
+const char* test_ns::get_scan_isa_name(scan_isa_t isa) {
+    switch (isa) {
+    case scan_isa_t::scalar:
+        return "scalar";
+    case scan_isa_t::sse2:
+        return "sse2";
+    case scan_isa_t::avx2:
+        return "avx2";
+    }
+    return "";
+}
+
+/*
+ * An instruction set the CPU does not have is replaced by the best one
+ * it has.
+ */
+test_ns::
+delimiter_scanner::delimiter_scanner(scan_isa_t isa)
+    : scan_block(get_scan_block(is_scan_isa_supported(isa) ? isa :
+              get_best_scan_isa())),
+      block(nullptr), position(nullptr), end(nullptr), masks{0, 0} {
+}
+
+/*
+ * text has to stay valid while its lines are taken.
+ */
+void test_ns::
+delimiter_scanner::reset(const str_view_t& text) {
+    position = text.begin();
+    end = text.end();
+    if (position != end) {
+        load_block(position);
+    }
+}
+
+/*
+ * Behaves like std::getline: a trailing newline does not produce an
+ * extra empty line, a last line without a newline is still returned.
+ */
+bool test_ns::
+delimiter_scanner::next_line(str_view_t* line, line_commas_t* commas) {
+    if (position == end) {
+        return false;
+    }
+    commas->size = 0;
+    commas->overflow = false;
+    for (;;) {
+        if (masks.newlines != 0) {
+            unsigned offset = __builtin_ctzll(masks.newlines);
+            uint64_t before = (uint64_t(1) << offset) - 1;
+            add_commas(block, masks.commas & before, commas);
+            const char* eol = block + offset;
+            *line = str_view_t(position, eol - position);
+            position = eol + 1;
+            // the newline and everything before it are consumed
+            uint64_t after = ~((before << 1) | 1);
+            masks.newlines &= after;
+            masks.commas &= after;
+            return true;
+        }
+        add_commas(block, masks.commas, commas);
+        if (static_cast<size_t>(end - block) <= block_size) {
+            *line = str_view_t(position, end - position);
+            position = end;
+            return true;
+        }
+        load_block(block + block_size);
+    }
+}
+
+/*
+ *
+ */
+test_ns::str_view_t test_ns::
+delimiter_scanner::take_rest() {
+    str_view_t rest(position, end - position);
+    position = end;
+    return rest;
+}
+
+/*
+ * The commas of a single line, with the best instruction set.
+ */
+void test_ns::
+delimiter_scanner::find_commas(const str_view_t& line,
+        line_commas_t* commas) {
+    static const scan_block_t best = get_scan_block(get_best_scan_isa());
+    find_commas(best, line, commas);
+}
+
+/*
+ *
+ */
+void test_ns::
+delimiter_scanner::find_commas(scan_isa_t isa, const str_view_t& line,
+        line_commas_t* commas) {
+    find_commas(get_scan_block(is_scan_isa_supported(isa) ? isa :
+            get_best_scan_isa()), line, commas);
+}
+
+/*
+ * Newlines are ignored, the whole of line is searched.
+ */
+void test_ns::
+delimiter_scanner::find_commas(scan_block_t scan, const str_view_t& line,
+        line_commas_t* commas) {
+    commas->size = 0;
+    commas->overflow = false;
+    masks_t line_masks;
+    for (const char* a_block = line.begin(); a_block < line.end() &&
+            !commas->overflow; a_block += block_size) {
+        load_block(scan, a_block, line.end(), &line_masks);
+        add_commas(a_block, line_masks.commas, commas);
+    }
+}
+
+/*
+ *
+ */
+void test_ns::
+delimiter_scanner::load_block(const char* a_block) {
+    block = a_block;
+    load_block(scan_block, block, end, &masks);
+}
+
+/*
+ * The masks of the block at block, a block that runs past end is
+ * copied so that nothing is read past end.
+ */
+void test_ns::
+delimiter_scanner::load_block(scan_block_t scan, const char* block,
+        const char* end, masks_t* masks) {
+    if (static_cast<size_t>(end - block) >= block_size) {
+        scan(block, masks);
+    } else {
+        char tail[block_size] = {};
+        std::memcpy(tail, block, end - block);
+        scan(tail, masks);
+    }
+}
+
+/*
+ *
+ */
+void test_ns::
+delimiter_scanner::add_commas(const char* block, uint64_t bits,
+        line_commas_t* commas) {
+    for (; bits != 0; bits &= bits - 1) {
+        if (commas->size == line_commas_t::max_size) {
+            commas->overflow = true;
+            return;
+        }
+        commas->positions[commas->size++] = block + __builtin_ctzll(bits);
+    }
+}
+
+/*
+ *
+ */
+test_ns::delimiter_scanner::scan_block_t test_ns::
+delimiter_scanner::get_scan_block(scan_isa_t isa) {
+    switch (isa) {
+    case scan_isa_t::sse2:
+        return scan_block_sse2;
+    case scan_isa_t::avx2:
+        return scan_block_avx2;
+    default:
+        return scan_block_scalar;
+    }
+}
+
+/*
+ *
+ */
+void test_ns::
+delimiter_scanner::scan_block_scalar(const char* block, masks_t* masks) {
+    uint64_t newlines = 0;
+    uint64_t commas = 0;
+    for (unsigned i = 0; i != block_size; ++i) {
+        newlines |= uint64_t(block[i] == '\n') << i;
+        commas |= uint64_t(block[i] == ',') << i;
+    }
+    masks->newlines = newlines;
+    masks->commas = commas;
+}
+
+#ifdef DELIMITER_SCANNER_X86
+
+/*
+ * Four 16 byte compares per delimiter.
+ */
+void test_ns::
+delimiter_scanner::scan_block_sse2(const char* block, masks_t* masks) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i comma = _mm_set1_epi8(',');
+    uint64_t newlines = 0;
+    uint64_t commas = 0;
+    for (unsigned i = 0; i != block_size; i += 16) {
+        __m128i bytes = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(block + i));
+        newlines |= uint64_t(static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline)))) << i;
+        commas |= uint64_t(static_cast<uint16_t>(
+                _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, comma)))) << i;
+    }
+    masks->newlines = newlines;
+    masks->commas = commas;
+}
+
+/*
+ * Two 32 byte compares per delimiter, only called if the CPU has AVX2.
+ */
+__attribute__((target("avx2")))
+void test_ns::
+delimiter_scanner::scan_block_avx2(const char* block, masks_t* masks) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i comma = _mm256_set1_epi8(',');
+    __m256i low = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i high = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(block + 32));
+    masks->newlines = uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(low, newline)))) |
+            uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(high, newline)))) << 32;
+    masks->commas = uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(low, comma)))) |
+            uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(high, comma)))) << 32;
+}
+
+#else
+
+/*
+ * Without x86 intrinsics the vector scans are the scalar one.
+ */
+void test_ns::
+delimiter_scanner::scan_block_sse2(const char* block, masks_t* masks) {
+    scan_block_scalar(block, masks);
+}
+
+/*
+ *
+ */
+void test_ns::
+delimiter_scanner::scan_block_avx2(const char* block, masks_t* masks) {
+    scan_block_scalar(block, masks);
+}
+
+#endif
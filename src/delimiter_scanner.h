@@ -0,0 +1,91 @@
+#ifndef DELIMITER_SCANNER_H
+#define DELIMITER_SCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Instruction sets a delimiter_scanner can use. avx2 is only used if
+ * the CPU running the program has it.
+ */
+enum class scan_isa_t { scalar, sse2, avx2 };
+
+scan_isa_t get_best_scan_isa();
+bool is_scan_isa_supported(scan_isa_t);
+const char* get_scan_isa_name(scan_isa_t);
+
+/*
+ * The commas of a line. A command has a name and at most five
+ * arguments, so a line with more commas than kept is not a valid
+ * command whatever they are.
+ */
+struct line_commas_t {
+    static const unsigned max_size = 7;
+    const char* positions[max_size];
+    unsigned size;
+    // the line has more than max_size commas
+    bool overflow;
+};
+
+/*
+ * Splits a text into lines and finds the commas of each line. The text
+ * is scanned 64 bytes at a time into masks of its newlines and commas,
+ * with SSE2 or AVX2 compares where available, and lines and commas are
+ * taken from the masks. Lines are split as line_reader::next_line()
+ * splits them.
+ */
+class delimiter_scanner {
+ public:
+    static const size_t block_size = 64;
+
+    explicit delimiter_scanner(scan_isa_t isa = get_best_scan_isa());
+
+    void reset(const str_view_t& text);
+    bool next_line(str_view_t* line, line_commas_t*);
+    /*
+     * The text next_line() has not returned yet, which is then taken
+     * as read.
+     */
+    str_view_t take_rest();
+
+    static void find_commas(const str_view_t& line, line_commas_t*);
+    static void find_commas(scan_isa_t, const str_view_t& line,
+            line_commas_t*);
+
+ private:
+    /*
+     * Bit i is set if byte i of a block is a newline or a comma.
+     */
+    struct masks_t {
+        uint64_t newlines;
+        uint64_t commas;
+    };
+    using scan_block_t = void (*)(const char* block, masks_t*);
+
+    scan_block_t scan_block;
+    const char* block;
+    const char* position;
+    const char* end;
+    // delimiters of the block at or after position
+    masks_t masks;
+
+    void load_block(const char* a_block);
+    static void load_block(scan_block_t, const char* block, const char* end,
+            masks_t*);
+    static void find_commas(scan_block_t, const str_view_t& line,
+            line_commas_t*);
+    static void add_commas(const char* block, uint64_t commas,
+            line_commas_t*);
+    static scan_block_t get_scan_block(scan_isa_t);
+    static void scan_block_scalar(const char* block, masks_t*);
+    static void scan_block_sse2(const char* block, masks_t*);
+    static void scan_block_avx2(const char* block, masks_t*);
+};
+
+}  // namespace test_ns
+
+#endif  // DELIMITER_SCANNER_H
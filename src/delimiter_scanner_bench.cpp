@@ -0,0 +1,158 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "delimiter_scanner.h"
+
+/*
+ * Compares the ways of splitting a feed into lines and finding the commas
+ * of each line: byte by byte, with a memchr() per delimiter as
+ * line_reader and parse_args() did before, and with delimiter_scanner on
+ * each instruction set the CPU has. Lines are 30 to 60 bytes, as the
+ * order lines of a feed.
+ */
+namespace {
+
+/*
+ * The result of a split, to check the methods agree and to keep the
+ * compiler from dropping the work.
+ */
+struct checksum_t {
+    size_t lines;
+    size_t commas;
+    size_t offsets;
+};
+
+std::string random_feed(size_t size) {
+    std::mt19937 random(1);
+    const char* sides[] = {"Buy", "Sell"};
+    std::string feed;
+    char line[128];
+    while (feed.size() < size) {
+        unsigned kind = random() % 10;
+        int n;
+        if (kind < 6) {
+            n = std::snprintf(line, sizeof(line),
+                    "ORDER ADD,%u,SYM%03u,%s,%u,%u.%02u\n",
+                    unsigned(random() % 10000000), unsigned(random() % 1000),
+                    sides[random() % 2], unsigned(1 + random() % 100000),
+                    unsigned(random() % 100000), unsigned(random() % 100));
+        } else if (kind < 8) {
+            n = std::snprintf(line, sizeof(line), "ORDER MODIFY,%u,%u,%u.%02u\n",
+                    unsigned(random() % 10000000),
+                    unsigned(1 + random() % 100000),
+                    unsigned(random() % 100000), unsigned(random() % 100));
+        } else {
+            n = std::snprintf(line, sizeof(line), "ORDER CANCEL,%u\n",
+                    unsigned(random() % 10000000));
+        }
+        feed.append(line, n);
+    }
+    return feed;
+}
+
+void add_line(const char* line, const char* end, const char* const* commas,
+        size_t size, checksum_t* sum) {
+    ++sum->lines;
+    sum->commas += size;
+    sum->offsets += end - line;
+    for (size_t i = 0; i != size; ++i) {
+        sum->offsets += commas[i] - line;
+    }
+}
+
+checksum_t split_bytes(const std::string& feed) {
+    checksum_t sum{0, 0, 0};
+    const char* commas[test_ns::line_commas_t::max_size];
+    size_t size = 0;
+    const char* line = feed.data();
+    for (const char* c = feed.data(); c != feed.data() + feed.size(); ++c) {
+        if (*c == ',') {
+            if (size != test_ns::line_commas_t::max_size) {
+                commas[size++] = c;
+            }
+        } else if (*c == '\n') {
+            add_line(line, c, commas, size, &sum);
+            line = c + 1;
+            size = 0;
+        }
+    }
+    return sum;
+}
+
+checksum_t split_memchr(const std::string& feed) {
+    checksum_t sum{0, 0, 0};
+    const char* commas[test_ns::line_commas_t::max_size];
+    const char* position = feed.data();
+    const char* end = feed.data() + feed.size();
+    while (position != end) {
+        auto eol = static_cast<const char*>(
+                std::memchr(position, '\n', end - position));
+        const char* line_end = eol == nullptr ? end : eol;
+        size_t size = 0;
+        for (const char* token = position; size !=
+                test_ns::line_commas_t::max_size; token = commas[size++] + 1) {
+            auto comma = static_cast<const char*>(
+                    std::memchr(token, ',', line_end - token));
+            if (comma == nullptr) {
+                break;
+            }
+            commas[size] = comma;
+        }
+        add_line(position, line_end, commas, size, &sum);
+        position = eol == nullptr ? end : eol + 1;
+    }
+    return sum;
+}
+
+checksum_t split_scanner(test_ns::scan_isa_t isa, const std::string& feed) {
+    checksum_t sum{0, 0, 0};
+    test_ns::delimiter_scanner scanner(isa);
+    scanner.reset(test_ns::str_view_t(feed));
+    test_ns::str_view_t line;
+    test_ns::line_commas_t commas;
+    while (scanner.next_line(&line, &commas)) {
+        add_line(line.begin(), line.end(), commas.positions, commas.size,
+                &sum);
+    }
+    return sum;
+}
+
+template<typename F>
+void run(const char* name, const std::string& feed, F split) {
+    const int rounds = 10;
+    checksum_t sum{0, 0, 0};
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        checksum_t one = split(feed);
+        sum.lines += one.lines;
+        sum.commas += one.commas;
+        sum.offsets += one.offsets;
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    std::printf("%-20s %6.2f ns/line %7.0f MB/s  (checksum %zu %zu %zu)\n",
+            name, ns / sum.lines, rounds * feed.size() / (ns / 1e3),
+            sum.lines / rounds, sum.commas / rounds, sum.offsets / rounds);
+}
+
+}  // namespace
+
+int main() {
+    std::string feed = random_feed(64 << 20);
+    run("byte by byte", feed, split_bytes);
+    run("memchr", feed, split_memchr);
+    for (auto isa : {test_ns::scan_isa_t::scalar, test_ns::scan_isa_t::sse2,
+            test_ns::scan_isa_t::avx2}) {
+        if (!test_ns::is_scan_isa_supported(isa)) {
+            continue;
+        }
+        std::string name = std::string("scanner ") +
+                test_ns::get_scan_isa_name(isa);
+        run(name.c_str(), feed, [isa](const std::string& text) {
+            return split_scanner(isa, text);
+        });
+    }
+}
@@ -0,0 +1,202 @@
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "delimiter_scanner.h"
+
+namespace {
+
+const test_ns::scan_isa_t all_isas[] = {test_ns::scan_isa_t::scalar,
+    test_ns::scan_isa_t::sse2, test_ns::scan_isa_t::avx2};
+
+/*
+ * A line and the offsets of its commas in the line, as many as
+ * line_commas_t keeps.
+ */
+struct scanned_line_t {
+    std::string line;
+    std::vector<size_t> commas;
+    bool overflow;
+
+    bool operator==(const scanned_line_t& other) const {
+        return line == other.line && commas == other.commas &&
+                overflow == other.overflow;
+    }
+};
+
+std::ostream& operator<<(std::ostream& out, const scanned_line_t& line) {
+    return out << line.line << " (" << line.commas.size() << " commas)";
+}
+
+scanned_line_t to_scanned(const test_ns::str_view_t& line,
+        const test_ns::line_commas_t& commas) {
+    scanned_line_t scanned{line.to_string(), {}, commas.overflow};
+    for (unsigned i = 0; i != commas.size; ++i) {
+        scanned.commas.push_back(commas.positions[i] - line.data);
+    }
+    return scanned;
+}
+
+/*
+ * Lines split as std::getline splits them, commas found byte by byte.
+ */
+std::vector<scanned_line_t> expected_lines(const std::string& text) {
+    std::vector<scanned_line_t> lines;
+    size_t begin = 0;
+    while (begin != text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        scanned_line_t line{text.substr(begin, end - begin), {}, false};
+        for (size_t i = 0; i != line.line.size(); ++i) {
+            if (line.line[i] != ',') {
+                continue;
+            }
+            if (line.commas.size() == test_ns::line_commas_t::max_size) {
+                line.overflow = true;
+                break;
+            }
+            line.commas.push_back(i);
+        }
+        lines.push_back(line);
+        begin = end == text.size() ? end : end + 1;
+    }
+    return lines;
+}
+
+std::vector<scanned_line_t> scan_lines(test_ns::scan_isa_t isa,
+        const std::string& text) {
+    test_ns::delimiter_scanner scanner(isa);
+    scanner.reset(test_ns::str_view_t(text));
+    std::vector<scanned_line_t> lines;
+    test_ns::str_view_t line;
+    test_ns::line_commas_t commas;
+    while (scanner.next_line(&line, &commas)) {
+        lines.push_back(to_scanned(line, commas));
+    }
+    return lines;
+}
+
+/*
+ * Lines of 0 to 150 bytes, so that lines and commas fall on both sides
+ * of block boundaries, some with more commas than are kept.
+ */
+std::string random_text(unsigned seed, size_t lines) {
+    std::mt19937 random(seed);
+    std::string text;
+    for (size_t i = 0; i != lines; ++i) {
+        size_t size = random() % 151;
+        for (size_t j = 0; j != size; ++j) {
+            unsigned kind = random() % 8;
+            text += kind == 0 ? ',' : char('A' + random() % 26);
+        }
+        text += '\n';
+    }
+    return text;
+}
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(DelimiterScanner, BestIsa) {
+    ASSERT_TRUE(test_ns::is_scan_isa_supported(test_ns::get_best_scan_isa()));
+    ASSERT_TRUE(test_ns::is_scan_isa_supported(test_ns::scan_isa_t::scalar));
+    ASSERT_STREQ(test_ns::get_scan_isa_name(test_ns::scan_isa_t::avx2),
+            "avx2");
+}
+
+/*
+ *
+ */
+TEST(DelimiterScanner, EmptyText) {
+    for (auto isa : all_isas) {
+        ASSERT_TRUE(scan_lines(isa, "").empty());
+        auto lines = scan_lines(isa, "\n\n");
+        ASSERT_EQ(lines.size(), 2);
+        ASSERT_EQ(lines[0].line, "");
+        ASSERT_EQ(lines[1].line, "");
+    }
+}
+
+/*
+ * The same lines and commas as a byte by byte scan, with every
+ * instruction set, with and without a last newline.
+ */
+TEST(DelimiterScanner, SameAsScalar) {
+    std::string text = random_text(1, 2000);
+    auto expected = expected_lines(text);
+    text.pop_back();
+    auto expected_no_newline = expected_lines(text);
+    ASSERT_EQ(expected.size(), expected_no_newline.size());
+    for (auto isa : all_isas) {
+        ASSERT_EQ(scan_lines(isa, text), expected_no_newline);
+        text += '\n';
+        ASSERT_EQ(scan_lines(isa, text), expected);
+        text.pop_back();
+    }
+}
+
+/*
+ * Nothing past the end of the text is read: a delimiter after it is
+ * not found.
+ */
+TEST(DelimiterScanner, StopsAtEnd) {
+    std::string buffer(200, ',');
+    std::memcpy(&buffer[0], "PRINT,S1\nPRINT", 14);
+    for (auto isa : all_isas) {
+        test_ns::delimiter_scanner scanner(isa);
+        scanner.reset(test_ns::str_view_t(buffer.data(), 14));
+        test_ns::str_view_t line;
+        test_ns::line_commas_t commas;
+        ASSERT_TRUE(scanner.next_line(&line, &commas));
+        ASSERT_EQ(line.to_string(), "PRINT,S1");
+        ASSERT_EQ(commas.size, 1);
+        ASSERT_TRUE(scanner.next_line(&line, &commas));
+        ASSERT_EQ(line.to_string(), "PRINT");
+        ASSERT_EQ(commas.size, 0);
+        ASSERT_FALSE(scanner.next_line(&line, &commas));
+    }
+}
+
+/*
+ *
+ */
+TEST(DelimiterScanner, TakeRest) {
+    std::string text = "a,b\nc,d\ne";
+    test_ns::delimiter_scanner scanner;
+    scanner.reset(test_ns::str_view_t(text));
+    test_ns::str_view_t line;
+    test_ns::line_commas_t commas;
+    ASSERT_TRUE(scanner.next_line(&line, &commas));
+    ASSERT_EQ(scanner.take_rest().to_string(), "c,d\ne");
+    ASSERT_FALSE(scanner.next_line(&line, &commas));
+}
+
+/*
+ * find_commas() searches the whole line, newlines included.
+ */
+TEST(DelimiterScanner, FindCommas) {
+    std::string line = "ORDER ADD,1," + std::string(100, 'S') + ",Buy,10,1.5";
+    test_ns::line_commas_t commas;
+    for (auto isa : all_isas) {
+        test_ns::delimiter_scanner::find_commas(isa,
+                test_ns::str_view_t(line), &commas);
+        ASSERT_EQ(commas.size, 5);
+        ASSERT_FALSE(commas.overflow);
+        ASSERT_EQ(commas.positions[0], line.data() + 9);
+        ASSERT_EQ(commas.positions[2], line.data() + 112);
+        ASSERT_EQ(commas.positions[4], line.data() + 119);
+    }
+    test_ns::delimiter_scanner::find_commas(test_ns::str_view_t(",\n,,,,,,,"),
+            &commas);
+    ASSERT_EQ(commas.size, test_ns::line_commas_t::max_size);
+    ASSERT_TRUE(commas.overflow);
+    test_ns::delimiter_scanner::find_commas(test_ns::str_view_t(), &commas);
+    ASSERT_EQ(commas.size, 0);
+    ASSERT_FALSE(commas.overflow);
+}
@@ -0,0 +1,81 @@
+#include "error_summary.h"
+
+#include <cstring>
+#include <iomanip>
+
+/*
+ *
+ */
+test_ns::
+error_summary::error_summary(uint64_t a_samples)
+    : samples(a_samples), counts() {
+}
+
+/*
+ *
+ */
+uint64_t test_ns::
+error_summary::get_total() const {
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+/*
+ * One row per category that had errors, with the number of errors not
+ * reported in full.
+ */
+void test_ns::
+error_summary::print(std::ostream& out) const {
+    out << "errors: " << get_total() << '\n';
+    for (size_t i = 0; i != error_categories; ++i) {
+        if (counts[i] == 0) {
+            continue;
+        }
+        uint64_t dropped = counts[i] > samples ? counts[i] - samples : 0;
+        out << "  " << std::left << std::setw(20)
+            << get_name(static_cast<error_category_t>(i))
+            << std::right << std::setw(12) << counts[i]
+            << ", not reported: " << dropped << '\n';
+    }
+}
+
+/*
+ *
+ */
+const char* test_ns::
+error_summary::get_name(error_category_t category) {
+    switch (category) {
+    case error_category_t::incorrect_command:
+        return "incorrect command";
+    case error_category_t::invalid_parameters:
+        return "invalid parameters";
+    case error_category_t::invalid_value:
+        return "invalid value";
+    case error_category_t::duplicate_order:
+        return "duplicate order";
+    case error_category_t::unknown_order:
+        return "unknown order";
+    default:
+        return "other";
+    }
+}
+
+/*
+ * The category of an error text of feed_handler::parse_command().
+ */
+test_ns::error_category_t test_ns::
+error_summary::get_category(const char* err) {
+    if (std::strcmp(err, "incorrect command") == 0) {
+        return error_category_t::incorrect_command;
+    }
+    if (std::strcmp(err, "invalid number of parameters") == 0) {
+        return error_category_t::invalid_parameters;
+    }
+    if (std::strncmp(err, "invalid ", 8) == 0) {
+        return error_category_t::invalid_value;
+    }
+    return error_category_t::other;
+}
@@ -0,0 +1,55 @@
+#ifndef ERROR_SUMMARY_H
+#define ERROR_SUMMARY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace test_ns {
+
+/*
+ * Kinds of errors a feed can cause, the rows of an error_summary.
+ */
+enum class error_category_t {
+    incorrect_command,
+    invalid_parameters,
+    invalid_value,
+    duplicate_order,
+    unknown_order,
+    other
+};
+const size_t error_categories = 6;
+
+/*
+ * Counts errors by category and lets the first samples of each
+ * category be reported in full, so that a corrupted feed costs a
+ * counter increment per bad line and a few lines of log.
+ */
+class error_summary {
+ public:
+    explicit error_summary(uint64_t samples);
+
+    /*
+     * Counts an error. Returns whether it is one of the samples of its
+     * category and should be reported.
+     */
+    bool count(error_category_t category) {
+        return ++counts[static_cast<size_t>(category)] <= samples;
+    }
+    uint64_t get_count(error_category_t category) const {
+        return counts[static_cast<size_t>(category)];
+    }
+    uint64_t get_total() const;
+    void print(std::ostream&) const;
+
+    static const char* get_name(error_category_t);
+    static error_category_t get_category(const char* err);
+
+ private:
+    uint64_t samples;
+    uint64_t counts[error_categories];
+};
+
+}  // namespace test_ns
+
+#endif  // ERROR_SUMMARY_H
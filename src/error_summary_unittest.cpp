@@ -0,0 +1,44 @@
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "error_summary.h"
+
+/*
+ *
+ */
+TEST(ErrorSummary, Count) {
+    test_ns::error_summary summary(2);
+    ASSERT_EQ(summary.get_total(), 0);
+    ASSERT_TRUE(summary.count(test_ns::error_category_t::unknown_order));
+    ASSERT_TRUE(summary.count(test_ns::error_category_t::unknown_order));
+    ASSERT_FALSE(summary.count(test_ns::error_category_t::unknown_order));
+    ASSERT_TRUE(summary.count(test_ns::error_category_t::duplicate_order));
+    ASSERT_EQ(summary.get_count(test_ns::error_category_t::unknown_order), 3);
+    ASSERT_EQ(summary.get_count(test_ns::error_category_t::other), 0);
+    ASSERT_EQ(summary.get_total(), 4);
+}
+
+TEST(ErrorSummary, Category) {
+    ASSERT_EQ(test_ns::error_summary::get_category("incorrect command"),
+            test_ns::error_category_t::incorrect_command);
+    ASSERT_EQ(test_ns::error_summary::get_category(
+            "invalid number of parameters"),
+            test_ns::error_category_t::invalid_parameters);
+    ASSERT_EQ(test_ns::error_summary::get_category("invalid price"),
+            test_ns::error_category_t::invalid_value);
+    ASSERT_EQ(test_ns::error_summary::get_category("not implemented"),
+            test_ns::error_category_t::other);
+}
+
+TEST(ErrorSummary, Print) {
+    test_ns::error_summary summary(1);
+    summary.count(test_ns::error_category_t::invalid_value);
+    summary.count(test_ns::error_category_t::unknown_order);
+    summary.count(test_ns::error_category_t::unknown_order);
+    std::ostringstream out;
+    summary.print(out);
+    ASSERT_EQ(out.str(), "errors: 3\n"
+            "  invalid value                  1, not reported: 0\n"
+            "  unknown order                  2, not reported: 1\n");
+}
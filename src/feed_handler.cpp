@@ -1,4 +1,6 @@
 #include "feed_handler.h"
+#include "line_writer.h"
+#include "numeric_parse.h"
 
 #include <iostream>
 #include <cstring>
@@ -7,149 +9,593 @@
 #include <string>
 #include <sstream>
 #include <cassert>
-#include <iomanip>
 /*
  *
  */
 test_ns::
 feed_handler::feed_handler(const std::string& selected_symbol,
-        callback_t&& a_callback, err_callback_t&& an_err_callback) :
-        callback(std::move(a_callback)),
+        callback_t&& a_callback, err_callback_t&& an_err_callback,
+        const book_config_t& config) :
+        feed_handler(selected_symbol, nullptr, std::move(an_err_callback),
+                config) {
+    own_output.reset(new callback_sink(std::move(a_callback)));
+    output = own_output.get();
+}
+
+/*
+ * Output lines are appended to output, which has to outlive the
+ * feed_handler and be flushed by the caller. Errors are dropped if the
+ * error callback is empty.
+ */
+test_ns::
+feed_handler::feed_handler(const std::string& selected_symbol,
+        output_sink* an_output, err_callback_t&& an_err_callback,
+        const book_config_t& config) :
+        output(an_output),
         err_callback(std::move(an_err_callback)),
-        selected_symbol(selected_symbol) {
+        errors(nullptr),
+        selected_symbol(selected_symbol),
+        book_config(config),
+        symbols(new symbol_table()),
+        selected_symbol_id(no_symbol),
+        bbo_symbols(name_less_t{symbols.get()}),
+        vwap_symbols(name_less_t{symbols.get()}),
+        avoided_vwaps(0) {
+    if (!selected_symbol.empty()) {
+        selected_symbol_id = symbols->intern(selected_symbol);
+    }
 }
 
 /*
  *
  */
+namespace {
+struct command_name_t {
+    const char* name;
+    size_t size;
+    test_ns::command_t command;
+};
 
-static
-std::unordered_map<std::string, test_ns::command_t> string_to_cmd = {
-        { "ORDER ADD", test_ns::command_t::order_add },
-        { "ORDER MODIFY", test_ns::command_t::order_modify },
-        { "ORDER CANCEL", test_ns::command_t::order_cancel},
-        { "SUBSCRIBE BBO", test_ns::command_t::subs_bbo },
-        { "UNSUBSCRIBE BBO", test_ns::command_t::unsubs_bbo },
-        { "SUBSCRIBE VWAP", test_ns::command_t::subs_vwap },
-        { "UNSUBSCRIBE VWAP", test_ns::command_t::unsubs_vwap },
-        { "PRINT", test_ns::command_t::print },
-        { "PRINT_FULL", test_ns::command_t::print_full }
+const command_name_t command_names[] = {
+        { "ORDER ADD", 9, test_ns::command_t::order_add },
+        { "ORDER MODIFY", 12, test_ns::command_t::order_modify },
+        { "ORDER CANCEL", 12, test_ns::command_t::order_cancel},
+        { "SUBSCRIBE BBO", 13, test_ns::command_t::subs_bbo },
+        { "UNSUBSCRIBE BBO", 15, test_ns::command_t::unsubs_bbo },
+        { "SUBSCRIBE VWAP", 14, test_ns::command_t::subs_vwap },
+        { "UNSUBSCRIBE VWAP", 16, test_ns::command_t::unsubs_vwap },
+        { "PRINT", 5, test_ns::command_t::print },
+        { "PRINT_FULL", 10, test_ns::command_t::print_full }
 };
+}  // namespace
 
 /*
  *
  */
 test_ns::command_t test_ns::
-feed_handler::parse_command(const std::string& line) {
+feed_handler::parse_command_name(const str_view_t& line,
+        const line_commas_t& commas) {
     if (line.empty())
         return command_t::none;
-    std::string::size_type position = line.find(',');
-    auto itr = string_to_cmd.find(line.substr(0, position));
-    if (itr == string_to_cmd.end()) {
-        return command_t::none;
+    size_t size = commas.size == 0 ? line.size :
+            commas.positions[0] - line.data;
+    for (auto const & a_command : command_names) {
+        if (a_command.size == size &&
+                std::memcmp(a_command.name, line.data, size) == 0) {
+            return a_command.command;
+        }
     }
-    return itr->second;
+    return command_t::none;
 }
 
 /*
  *
  */
 void test_ns::
-feed_handler::process_command(const std::string& line) {
-    command_t command = parse_command(line);
-    if (command == command_t::none) {
-        err_callback(line, "incorrect command");
-        return;
+feed_handler::process_command(const str_view_t& line) {
+    line_commas_t commas;
+    delimiter_scanner::find_commas(line, &commas);
+    process_command(line, commas);
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::process_command(const str_view_t& line,
+        const line_commas_t& commas) {
+    if (apply_line(line, commas)) {
+        print_subs();
     }
-    switch (command) {
-    case command_t::order_add:
-        process_order_add(line);
-        break;
+}
+
+/*
+ * process_command() without printing the subscriptions. Returns whether
+ * process_command() would print them, a line that is not a command at
+ * all prints nothing. symbol, if given, is set to the symbol whose
+ * subscription lines the command may have changed, or left empty.
+ */
+bool test_ns::
+feed_handler::apply_line(const str_view_t& line, str_view_t* symbol) {
+    line_commas_t commas;
+    delimiter_scanner::find_commas(line, &commas);
+    return apply_line(line, commas, symbol);
+}
+
+/*
+ *
+ */
+bool test_ns::
+feed_handler::apply_line(const str_view_t& line, const line_commas_t& commas,
+        str_view_t* symbol) {
+    command_args_t command;
+    const char* err = parse_command(line, commas, selected_symbol, &command);
+    if (err != nullptr) {
+        report_error(line, err);
+        return command.command != command_t::none;
+    }
+    if (symbol != nullptr) {
+        *symbol = get_command_symbol(command);
+    }
+    apply_record(to_record(command), &line);
+    return true;
+}
+
+/*
+ * The symbol whose subscription lines the command may change: the one
+ * of a subscription command, or the one of an order command if it has
+ * subscriptions. The symbol of a modified or cancelled order is the one
+ * of its book, it is looked up before the order is gone.
+ */
+test_ns::str_view_t test_ns::
+feed_handler::get_command_symbol(const command_args_t& command) const {
+    str_view_t symbol = command.symbol;
+    switch (command.command) {
+    case command_t::none:
+    case command_t::print:
+    case command_t::print_full:
+        return str_view_t();
+    case command_t::subs_bbo:
+    case command_t::unsubs_bbo:
+    case command_t::subs_vwap:
+    case command_t::unsubs_vwap:
+        return symbol;
     case command_t::order_modify:
-        process_order_modify(line);
+    case command_t::order_cancel: {
+        auto ref = order_refs.find(command.id);
+        if (ref == nullptr) {
+            return str_view_t();
+        }
+        symbol = ref->book->get_symbol();
         break;
-    case command_t::order_cancel:
-        process_order_cancel(line);
+    }
+    default:
         break;
+    }
+    auto entry = find_entry(symbols->find(symbol));
+    bool subscribed = entry != nullptr &&
+            (entry->bbo.count > 0 || !entry->vwaps.empty());
+    return subscribed ? symbol : str_view_t();
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::process_command(const command_args_t& command) {
+    apply_record(to_record(command), nullptr);
+    print_subs();
+}
+
+/*
+ * A command parse_command() decoded from line, errors quote the line
+ * as process_command() of the line would.
+ */
+void test_ns::
+feed_handler::process_command(const command_args_t& command,
+        const str_view_t& line) {
+    apply_record(to_record(command), &line);
+    print_subs();
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::parse_line(const str_view_t& line,
+        const str_view_t& selected_symbol, parsed_line_t* parsed) {
+    line_commas_t commas;
+    delimiter_scanner::find_commas(line, &commas);
+    parse_line(line, commas, selected_symbol, parsed);
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::parse_line(const str_view_t& line, const line_commas_t& commas,
+        const str_view_t& selected_symbol, parsed_line_t* parsed) {
+    parsed->line = line;
+    parsed->valid = parse_command(line, commas, selected_symbol,
+            &parsed->command) == nullptr;
+}
+
+/*
+ * The same as process_command() of the line. A line that did not parse
+ * is parsed again, so that it is reported with its error.
+ */
+void test_ns::
+feed_handler::process_parsed(const parsed_line_t& parsed) {
+    if (parsed.valid) {
+        process_command(parsed.command, parsed.line);
+    } else {
+        process_command(parsed.line);
+    }
+}
+
+/*
+ * The symbol of record has to come from intern_symbol() of this
+ * feed_handler. A record with a symbol id it did not give out is
+ * reported and skipped.
+ */
+void test_ns::
+feed_handler::process(const command_record_t& record) {
+    process_record(record, nullptr);
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::process(const command_record_t& record,
+        const str_view_t& line) {
+    process_record(record, &line);
+}
+
+/*
+ * line, if given, is the source line of the record.
+ */
+void test_ns::
+feed_handler::process_record(const command_record_t& record,
+        const str_view_t* line) {
+    if (!is_valid_record(record)) {
+        report_error(record, line, error_category_t::invalid_value,
+                "invalid symbol id");
+    } else {
+        apply_record(record, line);
+    }
+    print_subs();
+}
+
+/*
+ * The same as process() on each record in turn.
+ */
+void test_ns::
+feed_handler::process_batch(const command_record_t* records, size_t size) {
+    for (size_t i = 0; i != size; ++i) {
+        process(records[i]);
+    }
+}
+
+/*
+ *
+ */
+test_ns::symbol_id_t test_ns::
+feed_handler::intern_symbol(const str_view_t& symbol) {
+    return symbols->intern(symbol);
+}
+
+/*
+ * no_symbol if the symbol has not been interned.
+ */
+test_ns::symbol_id_t test_ns::
+feed_handler::find_symbol(const str_view_t& symbol) const {
+    return symbols->find(symbol);
+}
+
+/*
+ * A command which can only refer to a symbol already seen looks it up
+ * without interning it, its symbol is no_symbol if there is none.
+ */
+test_ns::command_record_t test_ns::
+feed_handler::to_record(const command_args_t& command) {
+    command_record_t record{command.id, command.quantity, command.price,
+        no_symbol, command.command, command.side};
+    switch (command.command) {
+    case command_t::order_add:
     case command_t::subs_bbo:
-        process_subs_bbo(line);
-        break;
-    case command_t::unsubs_bbo:
-        process_unsubs_bbo(line);
-        break;
     case command_t::subs_vwap:
-        process_subs_vwap(line);
+        record.symbol = symbols->intern(command.symbol);
         break;
+    case command_t::unsubs_bbo:
     case command_t::unsubs_vwap:
-        process_unsubs_vwap(line);
-        break;
     case command_t::print:
-        print(line);
-        break;
     case command_t::print_full:
-        print_full(line);
+        record.symbol = symbols->find(command.symbol);
         break;
     default:
-        err_callback(line, "not implemented");
         break;
     }
-    if (!bbo_subs.empty()) {
+    return record;
+}
+
+/*
+ * The command as it would be parsed, for error messages.
+ */
+test_ns::command_args_t test_ns::
+feed_handler::to_args(const command_record_t& record) const {
+    command_args_t command{record.command, record.id, str_view_t(),
+        record.side, record.quantity, record.price};
+    if (record.symbol < symbols->size()) {
+        command.symbol = symbols->get_name(record.symbol);
+    }
+    return command;
+}
+
+/*
+ *
+ */
+bool test_ns::
+feed_handler::is_valid_record(const command_record_t& record) const {
+    switch (record.command) {
+    case command_t::order_add:
+    case command_t::subs_bbo:
+    case command_t::subs_vwap:
+        return record.symbol < symbols->size();
+    case command_t::unsubs_bbo:
+    case command_t::unsubs_vwap:
+    case command_t::print:
+    case command_t::print_full:
+        return record.symbol == no_symbol || record.symbol < symbols->size();
+    default:
+        return true;
+    }
+}
+
+/*
+ * From then on errors are counted in summary, which has to outlive the
+ * feed_handler. Only the first errors of each category, as many as the
+ * samples of summary, are passed to the error callback.
+ */
+void test_ns::
+feed_handler::set_error_summary(error_summary* summary) {
+    errors = summary;
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::print_subs() {
+    if (!bbo_symbols.empty()) {
         print_bbo_subs();
     }
-    if (!vwap_subs.empty()) {
+    if (!vwap_symbols.empty()) {
         print_vwap_subs();
     }
 }
 
+/*
+ * Checks the command line and decodes its arguments. Returns nullptr on
+ * success or the error text. A command for a symbol other than the
+ * selected one is returned as command_t::none without an error, its
+ * remaining fields are not validated.
+ */
+const char* test_ns::
+feed_handler::parse_command(const str_view_t& line,
+        const str_view_t& selected_symbol, command_args_t* command) {
+    line_commas_t commas;
+    delimiter_scanner::find_commas(line, &commas);
+    return parse_command(line, commas, selected_symbol, command);
+}
+
+/*
+ * commas are the ones of line, as delimiter_scanner finds them.
+ */
+const char* test_ns::
+feed_handler::parse_command(const str_view_t& line,
+        const line_commas_t& commas, const str_view_t& selected_symbol,
+        command_args_t* command) {
+    command->command = parse_command_name(line, commas);
+    switch (command->command) {
+    case command_t::order_add:
+        return parse_order_add(line, commas, selected_symbol, command);
+    case command_t::order_modify:
+        return parse_order_modify(line, commas, command);
+    case command_t::order_cancel:
+        return parse_order_cancel(line, commas, command);
+    case command_t::subs_bbo:
+    case command_t::print:
+    case command_t::print_full:
+        return parse_symbol_command(line, commas, selected_symbol, command);
+    case command_t::unsubs_bbo:
+        return parse_symbol_command(line, commas, str_view_t(), command);
+    case command_t::subs_vwap:
+        return parse_vwap_command(line, commas, selected_symbol, command);
+    case command_t::unsubs_vwap:
+        return parse_vwap_command(line, commas, str_view_t(), command);
+    default:
+        return "incorrect command";
+    }
+}
+
 /*
  *
  */
-void test_ns::
-feed_handler::process_order_add(const std::string& line) {
+const char* test_ns::
+feed_handler::parse_order_add(const str_view_t& line,
+        const line_commas_t& commas, const str_view_t& selected_symbol,
+        command_args_t* command) {
     args_t args;
-    if (!parse_args(line, 5, &args)) {
-        err_callback(line, "invalid number of parameters");
-        return;
+    if (!parse_args(line, commas, 5, &args)) {
+        return "invalid number of parameters";
     }
-    order_id_t id;
-    if (!str_to_order_id(args[0], &id)) {
-        err_callback(line, "invalid order id");
-        return;
+    if (!str_to_order_id(args[0], &command->id)) {
+        return "invalid order id";
+    }
+    if (!str_to_symbol(args[1], &command->symbol)) {
+        return "invalid symbol";
     }
+    if (!is_symbol_selected(selected_symbol, command->symbol)) {
+        command->command = command_t::none;
+        return nullptr;
+    }
+    if (!str_to_side(args[2], &command->side)) {
+        return "invalid side";
+    }
+    if (!str_to_quantity(args[3], &command->quantity)) {
+        return "invalid quantity";
+    }
+    if (!str_to_price(args[4], &command->price)) {
+        return "invalid price";
+    }
+    return nullptr;
+}
 
-    symbol_t symbol;
-    if (!str_to_symbol(args[1], &symbol)) {
-        err_callback(line, "invalid symbol");
-        return;
+/*
+ *
+ */
+const char* test_ns::
+feed_handler::parse_order_modify(const str_view_t& line,
+        const line_commas_t& commas, command_args_t* command) {
+    args_t args;
+    if (!parse_args(line, commas, 3, &args)) {
+        return "invalid number of parameters";
     }
-    if (!should_handle_symbol(symbol)) {
-        return;
+    if (!str_to_order_id(args[0], &command->id)) {
+        return "invalid order id";
+    }
+    if (!str_to_quantity(args[1], &command->quantity)) {
+        return "invalid quantity";
     }
+    if (!str_to_price(args[2], &command->price)) {
+        return "invalid price";
+    }
+    return nullptr;
+}
 
-    side_t side;
-    if (!str_to_side(args[2], &side)) {
-        err_callback(line, "invalid side");
-        return;
+/*
+ *
+ */
+const char* test_ns::
+feed_handler::parse_order_cancel(const str_view_t& line,
+        const line_commas_t& commas, command_args_t* command) {
+    args_t args;
+    if (!parse_args(line, commas, 1, &args)) {
+        return "invalid number of parameters";
+    }
+    if (!str_to_order_id(args[0], &command->id)) {
+        return "invalid order id";
     }
+    return nullptr;
+}
 
-    quantity_t quantity;
-    if (!str_to_quantity(args[3], &quantity)) {
-        err_callback(line, "invalid quantity");
-        return;
+/*
+ * SUBSCRIBE BBO, UNSUBSCRIBE BBO, PRINT and PRINT_FULL
+ */
+const char* test_ns::
+feed_handler::parse_symbol_command(const str_view_t& line,
+        const line_commas_t& commas, const str_view_t& selected_symbol,
+        command_args_t* command) {
+    args_t args;
+    if (!parse_args(line, commas, 1, &args)) {
+        return "invalid number of parameters";
     }
+    if (!str_to_symbol(args[0], &command->symbol)) {
+        return "invalid symbol";
+    }
+    if (!is_symbol_selected(selected_symbol, command->symbol)) {
+        command->command = command_t::none;
+    }
+    return nullptr;
+}
 
-    double price;
-    if (!str_to_price(args[4], &price)) {
-        err_callback(line, "invalid price");
-        return;
+/*
+ * SUBSCRIBE VWAP and UNSUBSCRIBE VWAP
+ */
+const char* test_ns::
+feed_handler::parse_vwap_command(const str_view_t& line,
+        const line_commas_t& commas, const str_view_t& selected_symbol,
+        command_args_t* command) {
+    args_t args;
+    if (!parse_args(line, commas, 2, &args)) {
+        return "invalid number of parameters";
     }
-    auto & an_order_book = get_order_book(symbol);
-    try {
-        an_order_book.add_order(id, side, quantity, price);
-        order_id_symbols[id] = symbol;
-    } catch (std::exception& e) {
-        err_callback(line, std::string("failed to add: ") + e.what());
-        return;
+    if (!str_to_symbol(args[0], &command->symbol)) {
+        return "invalid symbol";
+    }
+    if (!str_to_quantity(args[1], &command->quantity)) {
+        return "invalid quantity";
+    }
+    if (!is_symbol_selected(selected_symbol, command->symbol)) {
+        command->command = command_t::none;
+    }
+    return nullptr;
+}
+
+/*
+ * line is the source line of the command if there is one, it is only
+ * used for error messages.
+ */
+void test_ns::
+feed_handler::apply_record(const command_record_t& record,
+        const str_view_t* line) {
+    switch (record.command) {
+    case command_t::none:
+        break;
+    case command_t::order_add:
+        order_add(record, line);
+        break;
+    case command_t::order_modify:
+        order_modify(record, line);
+        break;
+    case command_t::order_cancel:
+        order_cancel(record, line);
+        break;
+    case command_t::subs_bbo:
+        subs_bbo(record);
+        break;
+    case command_t::unsubs_bbo:
+        decrement_bbo(record.symbol);
+        break;
+    case command_t::subs_vwap:
+        subs_vwap(record);
+        break;
+    case command_t::unsubs_vwap:
+        unsubs_vwap(record);
+        break;
+    case command_t::print:
+        print(record.symbol);
+        break;
+    case command_t::print_full:
+        print_full(record.symbol);
+        break;
+    default:
+        report_error(record, line, error_category_t::other,
+                "not implemented");
+        break;
+    }
+}
+
+/*
+ * Errors past the samples of an error summary are only counted. The
+ * texts are only built when there is an error callback.
+ */
+bool test_ns::
+feed_handler::should_report(error_category_t category) const {
+    if (errors != nullptr && !errors->count(category)) {
+        return false;
+    }
+    return static_cast<bool>(err_callback);
+}
+
+/*
+ * A line that failed to parse.
+ */
+void test_ns::
+feed_handler::report_error(const str_view_t& line, const char* err) const {
+    if (should_report(error_summary::get_category(err))) {
+        err_callback(line.to_string(), err);
     }
 }
 
@@ -157,281 +603,422 @@ feed_handler::process_order_add(const std::string& line) {
  *
  */
 void test_ns::
-feed_handler::process_order_modify(const std::string& line) {
-    args_t args;
-    if (!parse_args(line, 3, &args)) {
-        err_callback(line, "invalid number of parameters");
-        return;
+feed_handler::report_error(const command_record_t& record,
+        const str_view_t* line, error_category_t category,
+        const char* err) const {
+    if (should_report(category)) {
+        call_err_callback(record, line, err);
     }
-    order_id_t id;
-    if (!str_to_order_id(args[0], &id)) {
-        err_callback(line, "invalid order id");
+}
+
+/*
+ * An error about the order of the command, err is followed by its id.
+ */
+void test_ns::
+feed_handler::report_order_error(const command_record_t& record,
+        const str_view_t* line, error_category_t category,
+        const char* err) const {
+    if (!should_report(category)) {
         return;
     }
+    std::string text(err);
+    text += std::to_string(record.id);
+    call_err_callback(record, line, text.c_str());
+}
 
-    quantity_t quantity;
-    if (!str_to_quantity(args[1], &quantity)) {
-        err_callback(line, "invalid quantity");
-        return;
+/*
+ * Commands which did not come from a text line are reported in their
+ * CSV form.
+ */
+void test_ns::
+feed_handler::call_err_callback(const command_record_t& record,
+        const str_view_t* line, const char* err) const {
+    if (line != nullptr) {
+        err_callback(line->to_string(), err);
+    } else {
+        err_callback(format_command(to_args(record)), err);
     }
+}
 
-    double price;
-    if (!str_to_price(args[2], &price)) {
-        err_callback(line, "invalid price");
+/*
+ *
+ */
+void test_ns::
+feed_handler::order_add(const command_record_t& record,
+        const str_view_t* line) {
+    symbol_id_t symbol = record.symbol;
+    if (!should_handle_symbol(symbol)) {
         return;
     }
-    if (!is_there_order_book(id)) {
-        std::ostringstream ss;
-        ss << "failed to modify order: " << id;
-        err_callback(line, ss.str());
+    auto inserted = order_refs.insert(record.id, order_ref_t());
+    if (!inserted.second) {
+        report_order_error(record, line, error_category_t::duplicate_order,
+                "failed to add: This order already exist: ");
         return;
     }
+    auto & an_order_book = get_order_book(symbol);
+    inserted.first->book = &an_order_book;
+    inserted.first->node = an_order_book.insert_order({record.id,
+            record.quantity, record.price, record.side});
+}
 
-    auto & an_order_book = get_order_book_ref(id);
-    try {
-        an_order_book.modify_order(id, quantity, price);
-    } catch (std::exception& e) {
-        err_callback(line, std::string("failed to modify: ") + e.what());
+/*
+ * One probe of order_refs finds the book and the node of the order.
+ */
+void test_ns::
+feed_handler::order_modify(const command_record_t& record,
+        const str_view_t* line) {
+    auto ref = order_refs.find(record.id);
+    if (ref == nullptr) {
+        report_order_error(record, line, error_category_t::unknown_order,
+                "failed to modify order: ");
         return;
     }
+    ref->book->modify_order_at(ref->node, record.quantity, record.price);
 }
 
 /*
  *
  */
 void test_ns::
-feed_handler::process_order_cancel(const std::string& line) {
-    args_t args;
-    if (!parse_args(line, 1, &args)) {
-        err_callback(line, "invalid number of parameters");
+feed_handler::order_cancel(const command_record_t& record,
+        const str_view_t* line) {
+    order_ref_t ref;
+    if (!order_refs.erase(record.id, &ref)) {
+        report_order_error(record, line, error_category_t::unknown_order,
+                "failed to cancel order: ");
         return;
     }
-    order_id_t id;
-    if (!str_to_order_id(args[0], &id)) {
-        err_callback(line, "invalid order id");
+    ref.book->erase_order_at(ref.node);
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::subs_bbo(const command_record_t& record) {
+    symbol_id_t symbol = record.symbol;
+    if (!should_handle_symbol(symbol)) {
         return;
     }
+    if (get_entry(symbol).bbo.count++ == 0) {
+        bbo_symbols.insert(symbol);
+    }
+}
 
-    if (!is_there_order_book(id)) {
-        std::ostringstream ss;
-        ss << "failed to cancel order: " << id;
-        err_callback(line, ss.str());
+/*
+ *
+ */
+void test_ns::
+feed_handler::subs_vwap(const command_record_t& record) {
+    symbol_id_t symbol = record.symbol;
+    if (!should_handle_symbol(symbol)) {
         return;
     }
+    ++get_entry(symbol).vwaps[record.quantity].count;
+    vwap_symbols.insert(symbol);
+}
 
-    auto & an_order_book = get_order_book_ref(id);
-    try {
-        an_order_book.cancel_order(id);
-        order_id_symbols.erase(id);
-    } catch (std::exception& e) {
-        err_callback(line, std::string("failed to modify: ") + e.what());
+/*
+ *
+ */
+void test_ns::
+feed_handler::unsubs_vwap(const command_record_t& record) {
+    symbol_id_t symbol = record.symbol;
+    if (find_entry(symbol) == nullptr) {
         return;
     }
+    auto & vwaps = entries[symbol].vwaps;
+    auto itr = vwaps.find(record.quantity);
+    if (itr != vwaps.end()) {
+        if (itr->second.count <= 1) {
+            vwaps.erase(itr);
+            if (vwaps.empty()) {
+                vwap_symbols.erase(symbol);
+            }
+        } else {
+            --itr->second.count;
+        }
+    }
+}
+
+/*
+ *
+ */
+std::string test_ns::
+feed_handler::format_command(const command_args_t& command) {
+    std::ostringstream ss;
+    for (auto const & a_command : command_names) {
+        if (a_command.command == command.command) {
+            ss << a_command.name;
+            break;
+        }
+    }
+    switch (command.command) {
+    case command_t::order_add:
+        ss << ',' << command.id << ',' << command.symbol.to_string() << ','
+           << (command.side == side_t::buy ? "Buy" : "Sell") << ','
+           << command.quantity << ',';
+        ss << price_to_string(command.price);
+        break;
+    case command_t::order_modify:
+        ss << ',' << command.id << ',' << command.quantity << ',';
+        ss << price_to_string(command.price);
+        break;
+    case command_t::order_cancel:
+        ss << ',' << command.id;
+        break;
+    case command_t::subs_vwap:
+    case command_t::unsubs_vwap:
+        ss << ',' << command.symbol.to_string() << ',' << command.quantity;
+        break;
+    case command_t::subs_bbo:
+    case command_t::unsubs_bbo:
+    case command_t::print:
+    case command_t::print_full:
+        ss << ',' << command.symbol.to_string();
+        break;
+    default:
+        break;
+    }
+    return ss.str();
+}
+
+/*
+ *
+ */
+unsigned test_ns::
+feed_handler::get_total_number_bbo_subs() const {
+    return bbo_symbols.size();
+}
+
+/*
+ *
+ */
+unsigned test_ns::
+feed_handler::get_bbo_subs_number(const symbol_t& s) const {
+    auto entry = find_entry(symbols->find(s));
+    return entry == nullptr ? 0 : entry->bbo.count;
 }
 
 /*
  *
  */
-void test_ns::
-feed_handler::process_subs_bbo(const std::string& line) {
-    args_t args;
-    auto res = parse_args(line, 1, &args);
-    if (!res) {
-        err_callback(line, "invalid number of parameters");
-        return;
-    }
-
-    symbol_t symbol;
-    if (!str_to_symbol(args[0], &symbol)) {
-        err_callback(line, "invalid symbol");
-        return;
-    }
-
-    if (!should_handle_symbol(symbol)) {
-        return;
+unsigned test_ns::
+feed_handler::get_total_number_vwap_subs() const {
+    unsigned number = 0;
+    for (symbol_id_t symbol : vwap_symbols) {
+        number += entries[symbol].vwaps.size();
     }
-    ++bbo_subs[symbol];
+    return number;
 }
 
 /*
  *
  */
-void test_ns::
-feed_handler::process_unsubs_bbo(const std::string& line) {
-    args_t args;
-    auto res = parse_args(line, 1, &args);
-    if (!res) {
-        err_callback(line, "invalid number of parameters");
-        return;
+unsigned test_ns::
+feed_handler::get_vwap_subs_number(const symbol_t& s, quantity_t q) const {
+    auto entry = find_entry(symbols->find(s));
+    if (entry == nullptr) {
+        return 0;
     }
-
-    symbol_t symbol;
-    if (!str_to_symbol(args[0], &symbol)) {
-        err_callback(line, "invalid symbol");
-        return;
+    auto itr = entry->vwaps.find(q);
+    if (itr != entry->vwaps.end()) {
+        return itr->second.count;
+    } else {
+        return 0;
     }
+}
 
-    decrement_bbo(symbol);
+/*
+ * VWAP lines printed again because the levels their quantity took
+ * from did not change, though the book did.
+ */
+uint64_t test_ns::
+feed_handler::get_avoided_vwaps_number() const {
+    return avoided_vwaps;
 }
 
 /*
  *
  */
 void test_ns::
-feed_handler::process_subs_vwap(const std::string& line) {
-    args_t args;
-    auto res = parse_args(line, 2, &args);
-    if (!res) {
-        err_callback(line, "invalid number of parameters");
-        return;
-    }
-
-    symbol_t symbol;
-    if (!str_to_symbol(args[0], &symbol)) {
-        err_callback(line, "invalid symbol");
+feed_handler::decrement_bbo(symbol_id_t symbol) {
+    if (find_entry(symbol) == nullptr) {
         return;
     }
-
-    quantity_t quantity;
-    if (!str_to_quantity(args[1], &quantity)) {
-        err_callback(line, "invalid quantity");
-        return;
-    }
-
-    if (!should_handle_symbol(symbol)) {
-        return;
+    auto & bbo = entries[symbol].bbo;
+    if (bbo.count == 1) {
+        bbo_symbols.erase(symbol);
+        bbo = subscription_t();
+    } else if (bbo.count > 1) {
+        --bbo.count;
     }
-
-    ++vwap_subs[std::make_pair(symbol, quantity)];
 }
 
 /*
- *
+ * Lines are formatted in place in the buffer of output.
  */
-void test_ns::
-feed_handler::process_unsubs_vwap(const std::string& line) {
-    args_t args;
-    auto res = parse_args(line, 2, &args);
-    if (!res) {
-        err_callback(line, "invalid number of parameters");
-        return;
-    }
+namespace {
 
-    symbol_t symbol;
-    if (!str_to_symbol(args[0], &symbol)) {
-        err_callback(line, "invalid symbol");
-        return;
-    }
-
-    quantity_t quantity;
-    if (!str_to_quantity(args[1], &quantity)) {
-        err_callback(line, "invalid quantity");
-        return;
-    }
+/*
+ * Room for a line of output besides its symbol.
+ */
+const size_t max_line_size = 128;
 
-    auto itr = vwap_subs.find(std::make_pair(symbol, quantity));
-    if (itr != vwap_subs.end()) {
-        if (itr->second <= 1) {
-            vwap_subs.erase(itr);
-        } else {
-            --itr->second;
-        }
+/*
+ * "volume@price" or nothing, in a column of 20.
+ */
+void put_price_level(test_ns::line_writer* line,
+        const test_ns::price_level_t& level) {
+    const char* field = line->end();
+    if (level.first) {
+        line->put_number(level.second.volume);
+        line->put('@');
+        line->put_double(test_ns::price_to_double(level.second.price));
+    } else {
+        line->put(' ');
     }
+    line->pad(field, 20);
 }
 
 /*
  *
  */
-unsigned test_ns::
-feed_handler::get_total_number_bbo_subs() const {
-    return bbo_subs.size();
+void put_optional_price(test_ns::line_writer* line,
+        const test_ns::optional_price_t& price, test_ns::quantity_t quantity) {
+    if (price.valid) {
+        line->put_double(test_ns::notional_to_double(price.notional,
+                quantity));
+    } else {
+        line->put("NIL");
+    }
 }
 
 /*
- *
+ * Columns of 10 for PRINT_FULL.
  */
-unsigned test_ns::
-feed_handler::get_bbo_subs_number(const symbol_t& s) const {
-    auto itr = bbo_subs.find(s);
-    if (itr != bbo_subs.end()) {
-        return itr->second;
+void put_column(test_ns::line_writer* line, const test_ns::str_view_t& s) {
+    const char* field = line->end();
+    line->put(s);
+    line->pad(field, 10);
+}
+
+void put_column(test_ns::line_writer* line, uint64_t value) {
+    const char* field = line->end();
+    line->put_number(value);
+    line->pad(field, 10);
+}
+
+void put_orders_columns(test_ns::line_writer* line,
+        const test_ns::full_orders_t& orders) {
+    if (orders.valid) {
+        put_column(line, orders.orders);
+        put_column(line, orders.volume);
+        const char* field = line->end();
+        line->put_double(test_ns::price_to_double(orders.price));
+        line->pad(field, 10);
     } else {
-        return 0;
+        line->fill(' ', 30);
     }
 }
 
+}  // namespace
+
 /*
- *
+ * Only the lines of books changed since the last print are formatted.
  */
-unsigned test_ns::
-feed_handler::get_total_number_vwap_subs() const {
-    return vwap_subs.size();
+void test_ns::
+feed_handler::print_bbo_subs() {
+    for (symbol_id_t symbol_id : bbo_symbols) {
+        print_bbo(symbol_id, output);
+    }
 }
 
 /*
- *
+ * A symbol without a book has no BBO line.
  */
-unsigned test_ns::
-feed_handler::get_vwap_subs_number(const symbol_t& s, quantity_t q) const {
-    auto itr = vwap_subs.find(std::make_pair(s, q));
-    if (itr != vwap_subs.end()) {
-        return itr->second;
-    } else {
-        return 0;
+void test_ns::
+feed_handler::print_bbo(symbol_id_t symbol_id, output_sink* out) {
+    auto & entry = entries[symbol_id];
+    auto order_book = entry.book.get();
+    if (order_book == nullptr) {
+        return;
+    }
+    auto & subscription = entry.bbo;
+    if (subscription.is_cached(order_book)) {
+        out->write_line(subscription.line);
+        return;
     }
+    auto const & symbol = symbols->get_name(symbol_id);
+    bbo_t bbo;
+    order_book->get_bbo(&bbo);
+
+    char* start = out->reserve(symbol.size() + max_line_size);
+    line_writer line(start);
+    line.put("BBO: ");
+    const char* field = line.end();
+    line.put(symbol);
+    line.pad(field, 10);
+    put_price_level(&line, bbo.buy);
+    line.put(" | ");
+    put_price_level(&line, bbo.sell);
+    subscription.cache(order_book, str_view_t(start, line.end() - start));
+    out->commit(line.end());
+    out->end_line();
 }
 
 /*
  *
  */
 void test_ns::
-feed_handler::decrement_bbo(const symbol_t& s) {
-    auto itr = bbo_subs.find(s);
-    if (itr != bbo_subs.end()) {
-        if (itr->second <= 1) {
-            bbo_subs.erase(itr);
-        } else {
-            --itr->second;
-        }
+feed_handler::print_vwap_subs() {
+    for (symbol_id_t symbol_id : vwap_symbols) {
+        print_vwaps(symbol_id, output);
     }
 }
 
 /*
- *
+ * As print_bbo(), a symbol without a book is printed as NIL. A VWAP is
+ * not computed again while the levels it took from are as they were at
+ * the last print, every line of the symbol is up to date at the end and
+ * the changes of its book are marked.
  */
 void test_ns::
-feed_handler::print_bbo_subs() const {
-    std::ostringstream ss, field1, field2;
-    for (auto const & sym_and_ref : bbo_subs) {
-        auto const & symbol = sym_and_ref.first;
-        if (!is_there_order_book(symbol)) {
+feed_handler::print_vwaps(symbol_id_t symbol_id, output_sink* out) {
+    auto & entry = entries[symbol_id];
+    auto order_book = entry.book.get();
+    vwap_quantities.clear();
+    for (auto & quantity_and_sub : entry.vwaps) {
+        auto & subscription = quantity_and_sub.second;
+        if (subscription.is_cached(order_book)) {
             continue;
         }
-        auto const & order_book = get_order_book_ref(symbol);
-        bbo_t bbo;
-        order_book.get_bbo(&bbo);
-
-        ss.str("");
-        field1.str("");
-        field2.str("");
-
-        ss << "BBO: " << std::left << std::setw(10) << symbol;
-        ss << std::left << std::setw(20);
-        if (bbo.buy.first) {
-            field1 << bbo.buy.second.volume << '@' << bbo.buy.second.price;
-            ss << field1.str();
-        } else {
-            ss << ' ';
+        if (subscription.is_reach_unchanged(order_book)) {
+            subscription.version = order_book->get_version();
+            ++avoided_vwaps;
+            continue;
         }
-        ss << " | ";
-        ss << std::left << std::setw(20);
-        if (bbo.sell.first) {
-            field2 << bbo.sell.second.volume << '@' << bbo.sell.second.price;
-            ss << field2.str();
-        } else {
-            ss << ' ';
+        vwap_quantities.push_back(quantity_and_sub.first);
+    }
+    vwap_results.resize(vwap_quantities.size());
+    if (order_book != nullptr && !vwap_quantities.empty()) {
+        order_book->get_vwaps(vwap_quantities.data(),
+                vwap_quantities.size(), vwap_results.data());
+    }
+    size_t next = 0;
+    for (auto & quantity_and_sub : entry.vwaps) {
+        auto & subscription = quantity_and_sub.second;
+        if (subscription.is_cached(order_book)) {
+            out->write_line(subscription.line);
+            continue;
         }
-        callback(ss.str());
+        print_vwap(symbol_id, order_book, vwap_results[next++],
+                &subscription, out);
+    }
+    if (order_book != nullptr &&
+            order_book->get_mark_version() != order_book->get_version()) {
+        order_book->mark_changes();
     }
 }
 
@@ -439,83 +1026,80 @@ feed_handler::print_bbo_subs() const {
  *
  */
 void test_ns::
-feed_handler::print_vwap_subs() const {
-    std::ostringstream ss;
-    for (auto const & vwap_and_ref : vwap_subs) {
-        auto const & symbol = vwap_and_ref.first.first;
-        auto const & quantity = vwap_and_ref.first.second;
-        ss.str("");
-
-        if (!is_there_order_book(symbol)) {
-            ss << "VWAP: " << std::left << std::setw(10) << symbol
-               << " <NIL,NIL>";
-            callback(ss.str());
-            continue;
-        }
-        auto const & order_book = get_order_book_ref(symbol);
-        vwap_t vwap;
-        order_book.get_vwap(quantity, &vwap);
+feed_handler::print_vwap(symbol_id_t symbol_id, const order_book* book,
+        const vwap_t& vwap, subscription_t* subscription, output_sink* out) {
+    auto const & symbol = symbols->get_name(symbol_id);
+    char* start = out->reserve(symbol.size() + max_line_size);
+    line_writer line(start);
+    line.put("VWAP: ");
+    const char* field = line.end();
+    line.put(symbol);
+    line.pad(field, 10);
+
+    if (book == nullptr) {
+        line.put(" <NIL,NIL>");
+    } else {
+        line.put(" <");
+        put_optional_price(&line, vwap.buy, vwap.quantity);
+        line.put(',');
+        put_optional_price(&line, vwap.sell, vwap.quantity);
+        line.put('>');
+    }
+    subscription->cache(book, str_view_t(start, line.end() - start));
+    subscription->buy_reach = std::make_pair(vwap.buy.valid, vwap.buy.reach);
+    subscription->sell_reach =
+            std::make_pair(vwap.sell.valid, vwap.sell.reach);
+    out->commit(line.end());
+    out->end_line();
+}
 
-        ss << "VWAP: " << std::left << std::setw(10) << symbol << " <";
-        if (vwap.buy.valid) {
-            ss << vwap.buy.price;
-        } else {
-            ss << "NIL";
-        }
-        ss << ",";
-        if (vwap.sell.valid) {
-            ss << vwap.sell.price;
-        } else {
-            ss << "NIL";
-        }
-        ss << ">";
-        callback(ss.str());
+/*
+ * The BBO line of one symbol, if it is subscribed to and has a book.
+ */
+void test_ns::
+feed_handler::print_symbol_bbo(const str_view_t& symbol, output_sink* out) {
+    symbol_id_t symbol_id = symbols->find(symbol);
+    auto entry = find_entry(symbol_id);
+    if (entry != nullptr && entry->bbo.count > 0) {
+        print_bbo(symbol_id, out);
     }
 }
 
 /*
- *
+ * The VWAP lines of one symbol, by quantity.
  */
 void test_ns::
-feed_handler::print(const symbol_t& line) const {
-    args_t args;
-    if (!parse_args(line, 1, &args)) {
-        err_callback(line, "invalid number of parameters");
-        return;
-    }
-    symbol_t symbol;
-    if (!str_to_symbol(args[0], &symbol)) {
-        err_callback(line, "invalid symbol");
-        return;
+feed_handler::print_symbol_vwaps(const str_view_t& symbol,
+        output_sink* out) {
+    symbol_id_t symbol_id = symbols->find(symbol);
+    auto entry = find_entry(symbol_id);
+    if (entry != nullptr && !entry->vwaps.empty()) {
+        print_vwaps(symbol_id, out);
     }
+}
+
+/*
+ *
+ */
+void test_ns::
+feed_handler::print(symbol_id_t symbol) const {
     if (!should_handle_symbol(symbol)) {
         return;
     }
-    if (!is_there_order_book(symbol)) {
+    auto order_book = find_order_book(symbol);
+    if (order_book == nullptr) {
         return;
     }
-    auto const & order_book = get_order_book_ref(symbol);
-    auto print_order_book_price_levels = [&]
+    auto print_order_book_price_levels = [this]
         (const price_level_t& bid, const price_level_t& ask) {
-        std::ostringstream ss, ss_field1, ss_field2;
-        ss << std::left << std::setw(20);
-        if (bid.first) {
-            ss_field1 << bid.second.volume << '@' << bid.second.price;
-            ss << ss_field1.str();
-        } else {
-            ss << ' ';
-        }
-        ss << " | ";
-        ss << std::left << std::setw(20);
-        if (ask.first) {
-            ss_field2 << ask.second.volume << '@' << ask.second.price;
-            ss << ss_field2.str();
-        } else {
-            ss << ' ';
-        }
-        callback(ss.str());
+        line_writer line(output->reserve(max_line_size));
+        put_price_level(&line, bid);
+        line.put(" | ");
+        put_price_level(&line, ask);
+        output->commit(line.end());
+        output->end_line();
     };
-    order_book.get_price_levels(std::move(print_order_book_price_levels));
+    order_book->get_price_levels(std::move(print_order_book_price_levels));
 }
 
 
@@ -523,130 +1107,71 @@ feed_handler::print(const symbol_t& line) const {
  *
  */
 void test_ns::
-feed_handler::print_full(const symbol_t& line) const {
-    args_t args;
-    if (!parse_args(line, 1, &args)) {
-        err_callback(line, "invalid number of parameters");
-        return;
-    }
-    symbol_t symbol;
-    if (!str_to_symbol(args[0], &symbol)) {
-        err_callback(line, "invalid symbol");
-        return;
-    }
+feed_handler::print_full(symbol_id_t symbol) const {
     if (!should_handle_symbol(symbol)) {
         return;
     }
-    if (!is_there_order_book(symbol)) {
+    auto order_book = find_order_book(symbol);
+    if (order_book == nullptr) {
         return;
     }
-    auto const & order_book = get_order_book_ref(symbol);
-    std::ostringstream ss;
-    auto format_column = [&ss]() {
-        ss << std::left << std::setw(10);
-    };
-    auto format_string = [&ss, &format_column] (const std::string& s) {
-        format_column();
-        ss << s;
-    };
-
-    auto format_number = [&ss, &format_column] (unsigned value) {
-        format_column();
-        ss << value;
-    };
-
-    auto format_quantity = [&ss, &format_column] (quantity_t value) {
-        format_column();
-        ss << value;
-    };
-
-    auto format_double = [&ss, &format_column] (double value) {
-        format_column();
-        ss << value;
-    };
-
-    auto format_spaces = [&ss, &format_column] (unsigned times) {
-        for (auto i = 0U; i < times; ++i) {
-            format_column();
-            ss << ' ';
-        }
-    };
-
-    auto separate_line = [&ss] () {
-        ss << std::setfill('-') << std::setw(60) << '-';
-        ss << std::setfill(' ');
-    };
-
-    auto print_string = [&ss, this] () {
-        this->callback(ss.str());
-        ss.str("");
+    auto separate_line = [this] () {
+        line_writer line(output->reserve(max_line_size));
+        line.fill('-', 60);
+        output->commit(line.end());
+        output->end_line();
     };
 
     separate_line();
-    print_string();
 
-    format_string("orders");
-    format_string("volume");
-    format_string("bid");
-    format_string("ask");
-    format_string("volume");
-    format_string("orders");
-    print_string();
+    line_writer header(output->reserve(max_line_size));
+    for (auto name : {"orders", "volume", "bid", "ask", "volume", "orders"}) {
+        put_column(&header, name);
+    }
+    output->commit(header.end());
+    output->end_line();
 
     separate_line();
-    print_string();
 
-    auto print_orders = [&format_number, &format_quantity, &format_double,
-                         &format_spaces, &print_string]
+    auto print_orders = [this]
         (const full_orders_t& bid, const full_orders_t& ask) {
-        if (bid.valid) {
-            format_number(bid.orders);
-            format_quantity(bid.volume);
-            format_double(bid.price);
-        } else {
-            format_spaces(3);
-        }
-        if (ask.valid) {
-            format_number(ask.orders);
-            format_quantity(ask.volume);
-            format_double(ask.price);
-        } else {
-            format_spaces(3);
-        }
-        print_string();
+        line_writer line(output->reserve(max_line_size));
+        put_orders_columns(&line, bid);
+        put_orders_columns(&line, ask);
+        output->commit(line.end());
+        output->end_line();
     };
-    order_book.get_full_orders(std::move(print_orders));
+    order_book->get_full_orders(std::move(print_orders));
     separate_line();
-    print_string();
 }
 
 /*
- *
+ * The arguments are the fields after the first comma. A line with more
+ * commas than line_commas_t keeps has too many of them.
  */
 bool test_ns::
-feed_handler::parse_args(const std::string& line,
-        unsigned number_args, args_t* args) const {
-    args->clear();
-    std::istringstream ss(line);
-    std::string token;
-    bool command_skipped = false;
-    unsigned parsed_args = 0;
-    while (std::getline(ss, token, ',') && parsed_args <= number_args) {
-        if (!command_skipped) {
-            command_skipped = true;
-            continue;
-        } else {
-            ++parsed_args;
-            args->push_back(token);
-        }
-    }
-    if (!command_skipped) {
+feed_handler::parse_args(const str_view_t& line, const line_commas_t& commas,
+        unsigned number_args, args_t* args) {
+    args->size = 0;
+    if (commas.size == 0 || commas.overflow) {
         return false;
     }
-    if (ss.eof() && parsed_args == number_args) {
-        return true;
+    const char* end = line.end();
+    for (unsigned i = 0; i != commas.size; ++i) {
+        const char* token = commas.positions[i] + 1;
+        // as with std::getline, a trailing comma does not start an empty
+        // field
+        if (token == end) {
+            break;
+        }
+        const char* token_end = i + 1 == commas.size ? end :
+                commas.positions[i + 1];
+        if (args->size == number_args || args->size == args_t::max_size) {
+            return false;
+        }
+        args->values[args->size++] = str_view_t(token, token_end - token);
     }
-    return false;
+    return args->size == number_args;
 }
 
 
@@ -654,17 +1179,15 @@ feed_handler::parse_args(const std::string& line,
  *
  */
 bool test_ns::
-feed_handler::str_to_order_id(const std::string& token, order_id_t* id) {
-    std::istringstream ss(token);
-    ss >> *id;
-    return static_cast<bool>(ss);
+feed_handler::str_to_order_id(const str_view_t& token, order_id_t* id) {
+    return parse_unsigned(token, id);
 }
 
 /*
  *
  */
 bool test_ns::
-feed_handler::str_to_symbol(const std::string& token, symbol_t* symbol) {
+feed_handler::str_to_symbol(const str_view_t& token, str_view_t* symbol) {
     if (token.empty())
         return false;
     *symbol = token;
@@ -675,7 +1198,7 @@ feed_handler::str_to_symbol(const std::string& token, symbol_t* symbol) {
  *
  */
 bool test_ns::
-feed_handler::str_to_side(const std::string& token, side_t* side) {
+feed_handler::str_to_side(const str_view_t& token, side_t* side) {
     if ( token == "Buy" ) {
         *side = side_t::buy;
         return true;
@@ -691,20 +1214,16 @@ feed_handler::str_to_side(const std::string& token, side_t* side) {
  *
  */
 bool test_ns::
-feed_handler::str_to_quantity(const std::string& token, quantity_t* quantity) {
-    std::istringstream ss(token);
-    ss >> *quantity;
-    return static_cast<bool>(ss);
+feed_handler::str_to_quantity(const str_view_t& token, quantity_t* quantity) {
+    return parse_unsigned(token, quantity);
 }
 
 /*
  *
  */
 bool test_ns::
-feed_handler::str_to_price(const std::string& token, double* price) {
-    std::istringstream ss(token);
-    ss >> *price;
-    return static_cast<bool>(ss);
+feed_handler::str_to_price(const str_view_t& token, price_t* price) {
+    return parse_price(token, price);
 }
 
 /*
@@ -719,105 +1238,64 @@ feed_handler::is_there_selected_symbol() const {
  *
  */
 bool test_ns::
-feed_handler::should_handle_symbol(const std::string& symbol) const {
-    if (selected_symbol.empty()) {
-        return true;
-    } else {
-        return selected_symbol == symbol;
-    }
-}
-
-/*
- *
- */
-test_ns::order_book& test_ns::
-feed_handler::get_order_book(const std::string& symbol) {
-    auto itr = order_books.find(symbol);
-    if (itr == order_books.end()) {
-        auto insert_res = order_books.insert(std::make_pair(
-                symbol, order_book(symbol)));
-        return insert_res.first->second;
-
-    } else {
-        return itr->second;
-    }
-}
-
-/*
- *
- */
-bool test_ns::
-feed_handler::is_there_order_book(const std::string& symbol) const {
-    return order_books.find(symbol) != order_books.end();
+feed_handler::should_handle_symbol(symbol_id_t symbol) const {
+    return selected_symbol_id == no_symbol || symbol == selected_symbol_id;
 }
 
 /*
  *
  */
 bool test_ns::
-feed_handler::is_there_order_book(const order_id_t& id) const {
-    auto itr = order_id_symbols.find(id);
-    if (itr != order_id_symbols.end()) {
-        return is_there_order_book(itr->second);
+feed_handler::is_symbol_selected(const str_view_t& selected_symbol,
+        const str_view_t& symbol) {
+    if (selected_symbol.empty()) {
+        return true;
     } else {
-        return false;
+        return selected_symbol == symbol;
     }
 }
 
 /*
  *
  */
-test_ns::order_book& test_ns::
-feed_handler::get_order_book_ref(const order_id_t& id) {
-    auto itr = order_id_symbols.find(id);
-    if (itr != order_id_symbols.end()) {
-        return get_order_book_ref(itr->second);
-    } else {
-        std::ostringstream ss;
-        ss << "No order book for " << id;
-        throw std::runtime_error(ss.str());
+test_ns::feed_handler::symbol_entry_t& test_ns::
+feed_handler::get_entry(symbol_id_t symbol) {
+    if (symbol >= entries.size()) {
+        entries.resize(symbol + 1);
     }
+    return entries[symbol];
 }
 
 /*
- *
+ * nullptr if the symbol is not known or has no entry yet.
  */
-const test_ns::order_book& test_ns::
-feed_handler::get_order_book_ref(const order_id_t& id) const {
-    auto itr = order_id_symbols.find(id);
-    if (itr != order_id_symbols.end()) {
-        return get_order_book_ref(itr->second);
-    } else {
-        std::ostringstream ss;
-        ss << "No order book for " << id;
-        throw std::runtime_error(ss.str());
+const test_ns::feed_handler::symbol_entry_t* test_ns::
+feed_handler::find_entry(symbol_id_t symbol) const {
+    if (symbol >= entries.size()) {
+        return nullptr;
     }
+    return &entries[symbol];
 }
 
 /*
  *
  */
 test_ns::order_book& test_ns::
-feed_handler::get_order_book_ref(const std::string& symbol) {
-    auto itr = order_books.find(symbol);
-    if (itr == order_books.end()) {
-        throw std::runtime_error("No order book for " + symbol);
-    } else {
-        return itr->second;
+feed_handler::get_order_book(symbol_id_t symbol) {
+    auto & book = get_entry(symbol).book;
+    if (!book) {
+        book.reset(new order_book(symbols->get_name(symbol), book_config));
     }
+    return *book;
 }
 
 /*
- *
+ * nullptr if the symbol has no book.
  */
-const test_ns::order_book& test_ns::
-feed_handler::get_order_book_ref(const std::string& symbol) const {
-    auto itr = order_books.find(symbol);
-    if (itr == order_books.end()) {
-        throw std::runtime_error("No order book for " + symbol);
-    } else {
-        return itr->second;
-    }
+const test_ns::order_book* test_ns::
+feed_handler::find_order_book(symbol_id_t symbol) const {
+    auto entry = find_entry(symbol);
+    return entry == nullptr ? nullptr : entry->book.get();
 }
 
 /*
@@ -834,15 +1312,15 @@ feed_handler::get_selected_symbol() const {
 test_ns::optional_order
 test_ns::feed_handler::get_order(const symbol_t& symbol,
         order_id_t id) const {
-    if (!should_handle_symbol(symbol)) {
+    symbol_id_t symbol_id = symbols->find(symbol);
+    if (symbol_id == no_symbol || !should_handle_symbol(symbol_id)) {
         return test_ns::optional_order{false, order_t()};
     }
-    if (!is_there_order_book(id)) {
+    auto ref = order_refs.find(id);
+    if (ref == nullptr || ref->book != find_order_book(symbol_id)) {
         return test_ns::optional_order{false, order_t()};
     }
-
-    auto & an_order_book = get_order_book_ref(symbol);
-    return an_order_book.get_order(id);
+    return test_ns::optional_order{true, ref->book->get_order_at(ref->node)};
 }
 
 /*
@@ -850,7 +1328,7 @@ test_ns::feed_handler::get_order(const symbol_t& symbol,
  */
 bool test_ns::
 feed_handler::is_there_symbol_for_order(order_id_t id) const {
-    return order_id_symbols.find(id) != order_id_symbols.end();
+    return order_refs.find(id) != nullptr;
 }
 
 /*
@@ -858,9 +1336,9 @@ feed_handler::is_there_symbol_for_order(order_id_t id) const {
  */
 test_ns::symbol_t test_ns::
 feed_handler::get_symbol_for_order(order_id_t id) const {
-    auto itr = order_id_symbols.find(id);
-    if (itr != order_id_symbols.end()) {
-        return itr->second;
+    auto ref = order_refs.find(id);
+    if (ref != nullptr) {
+        return ref->book->get_symbol();
     } else {
         return "";
     }
@@ -885,8 +1363,10 @@ void test_ns::print_to_stderr(
 /*
  *
  */
-test_ns::order_book::order_book(const symbol_t& symbol)
-    : symbol(symbol) {
+test_ns::order_book::order_book(const symbol_t& symbol,
+        const book_config_t& config)
+    : symbol(symbol), bids(config), sales(config), version(0),
+      mark_version(0), bid_changes{0, 0}, sale_changes{0, 0} {
 }
 
 /*
@@ -899,124 +1379,187 @@ const test_ns::symbol_t& test_ns::order_book::get_symbol() const {
 /*
  *
  */
-void test_ns::order_book::add_order(order_id_t id, side_t side,
-        quantity_t quantity, double price) {
-    auto itr = orders.find(id);
-    if (itr == orders.end()) {
-        orders[id] = {id, quantity, price, side};
-        if (side == side_t::buy) {
-            add_bid(price, id);
-        } else {
-            add_sale(price, id);
-        }
-    } else {
-        std::ostringstream s;
-        s << "This order already exist: " << id;
-        throw std::runtime_error(s.str());
+test_ns::book_status_t test_ns::order_book::add_order(order_id_t id,
+        side_t side, quantity_t quantity, price_t price) {
+    auto inserted = orders.insert(id, null_node);
+    if (!inserted.second) {
+        return book_status_t::duplicate_id;
+    }
+    *inserted.first = insert_order({id, quantity, price, side});
+    return book_status_t::ok;
+}
+
+/*
+ *
+ */
+test_ns::book_status_t test_ns::order_book::modify_order(order_id_t id,
+        quantity_t quantity, price_t price) {
+    auto node = orders.find(id);
+    if (node == nullptr) {
+        return book_status_t::unknown_id;
+    }
+    modify_order_at(*node, quantity, price);
+    return book_status_t::ok;
+}
+
+/*
+ *
+ */
+test_ns::book_status_t test_ns::order_book::cancel_order(order_id_t id) {
+    node_index_t node;
+    if (!orders.erase(id, &node)) {
+        return book_status_t::unknown_id;
     }
+    erase_order_at(node);
+    return book_status_t::ok;
+}
+
+/*
+ * Queues the order at its price, the node addresses it until it is
+ * erased.
+ */
+test_ns::node_index_t
+test_ns::order_book::insert_order(const order_t& an_order) {
+    node_index_t node = order_pool.allocate(an_order);
+    add_to_level(node);
+    return node;
 }
 
 /*
  *
  */
-void test_ns::order_book::modify_order(order_id_t id, quantity_t quantity,
-        double price) {
-    auto itr = orders.find(id);
-    if (itr == orders.end()) {
-        std::ostringstream s;
-        s << "This order does not exist: " << id;
-        throw std::runtime_error(s.str());
-    } else {
-        auto & an_order = itr->second;
-        if (an_order.side == side_t::buy) {
-            remove_bid(an_order.price, id);
-        } else {
-            remove_sale(an_order.price, id);
+const test_ns::order_t&
+test_ns::order_book::get_order_at(node_index_t node) const {
+    return order_pool[node].value;
+}
+
+/*
+ * The order loses its place in the queue of its level.
+ */
+void test_ns::order_book::modify_order_at(node_index_t node,
+        quantity_t quantity, price_t price) {
+    remove_from_level(node);
+    auto & an_order = order_pool[node].value;
+    an_order.quantity = quantity;
+    an_order.price = price;
+    add_to_level(node);
+}
+
+/*
+ *
+ */
+void test_ns::order_book::erase_order_at(node_index_t node) {
+    remove_from_level(node);
+    order_pool.release(node);
+}
+
+namespace {
+/*
+ * Walks the levels from the top until the largest quantity is filled,
+ * quantities are sorted in increasing order. A quantity filled inside
+ * a level takes that level partially. With a depth index each quantity
+ * is looked up instead.
+ */
+template <typename levels_t>
+void get_levels_vwaps(const levels_t& levels,
+        const test_ns::quantity_t* quantities, size_t size,
+        test_ns::vwap_t* vwaps,
+        test_ns::optional_price_t test_ns::vwap_t::*side) {
+    if (levels.has_depth_index()) {
+        for (size_t i = 0; i != size; ++i) {
+            test_ns::optional_price_t& price = vwaps[i].*side;
+            price.valid = levels.get_cost(quantities[i], &price.notional,
+                    &price.reach);
+            if (!price.valid) {
+                price.notional = 0;
+                price.reach = 0;
+            }
         }
-        an_order.quantity = quantity;
-        an_order.price = price;
-        if (an_order.side == side_t::buy) {
-            add_bid(price, id);
-        } else {
-            add_sale(price, id);
+        return;
+    }
+    test_ns::quantity_t found_quantity = 0;
+    test_ns::notional_t found_cost = 0;
+    size_t i = 0;
+    for (auto itr = levels.begin(); itr != levels.end() && i != size; ++itr) {
+        test_ns::price_t price = itr.price();
+        test_ns::quantity_t volume = itr.level().volume;
+        for (; i != size && quantities[i] - found_quantity <= volume; ++i) {
+            vwaps[i].*side = {true, found_cost +
+                    static_cast<test_ns::notional_t>(
+                            quantities[i] - found_quantity) * price, price};
         }
+        found_quantity += volume;
+        found_cost += static_cast<test_ns::notional_t>(volume) * price;
+    }
+    for (; i != size; ++i) {
+        vwaps[i].*side = {false, 0, 0};
     }
 }
+}  // namespace
 
 /*
- *
+ * Queues the order at the back of its price level.
  */
-void test_ns::order_book::cancel_order(order_id_t id) {
-    auto itr = orders.find(id);
-    if (itr == orders.end()) {
-        std::ostringstream s;
-        s << "This order does not exist: " << id;
-        throw std::runtime_error(s.str());
+void test_ns::order_book::add_to_level(node_index_t node) {
+    ++version;
+    const order_t& an_order = order_pool[node].value;
+    note_change(an_order.side, an_order.price);
+    if (an_order.side == side_t::buy) {
+        bids.add(an_order.price, node, an_order.quantity, &order_pool);
     } else {
-        auto & an_order = itr->second;
-        if (an_order.side == side_t::buy) {
-            remove_bid(an_order.price, id);
-        } else {
-            remove_sale(an_order.price, id);
-        }
-        orders.erase(itr);
+        sales.add(an_order.price, node, an_order.quantity, &order_pool);
     }
 }
 
 /*
  *
  */
-void test_ns::order_book::add_bid(double price, order_id_t id) {
-    auto itr = bids.find(price);
-    if (itr == bids.end()) {
-        auto res = bids.insert(std::make_pair(price, order_ids_t()));
-        itr = res.first;
+void test_ns::order_book::remove_from_level(node_index_t node) {
+    ++version;
+    const order_t& an_order = order_pool[node].value;
+    note_change(an_order.side, an_order.price);
+    if (an_order.side == side_t::buy) {
+        bids.remove(an_order.price, node, an_order.quantity, &order_pool);
+    } else {
+        sales.remove(an_order.price, node, an_order.quantity, &order_pool);
     }
-    auto & order_ids = itr->second;
-    order_ids.insert(id);
 }
 
 /*
- *
+ * Keeps the best changed price of the side, the best for bids is the
+ * highest.
  */
-void test_ns::order_book::remove_bid(double price, order_id_t id) {
-    auto itr = bids.find(price);
-    assert(itr != bids.end());
-    if (itr != bids.end()) {
-        auto & order_ids = itr->second;
-        order_ids.erase(id);
-        if (order_ids.empty()) {
-            bids.erase(itr);
+void test_ns::order_book::note_change(side_t side, price_t price) {
+    if (side == side_t::buy) {
+        if (bid_changes.count == 0 || price > bid_changes.best_price) {
+            bid_changes.best_price = price;
         }
+        ++bid_changes.count;
+    } else {
+        if (sale_changes.count == 0 || price < sale_changes.best_price) {
+            sale_changes.best_price = price;
+        }
+        ++sale_changes.count;
     }
 }
 
 /*
- *
+ * Whether a level at price or better changed since the last mark.
  */
-void test_ns::order_book::add_sale(double price, order_id_t id) {
-    auto itr = sales.find(price);
-    if (itr == sales.end()) {
-        auto res = sales.insert(std::make_pair(price, order_ids_t()));
-        itr = res.first;
+bool test_ns::order_book::is_changed_up_to(side_t side, price_t price) const {
+    if (side == side_t::buy) {
+        return bid_changes.count != 0 && bid_changes.best_price >= price;
     }
-    auto & order_ids = itr->second;
-    order_ids.insert(id);
+    return sale_changes.count != 0 && sale_changes.best_price <= price;
 }
 
 /*
  *
  */
-void test_ns::order_book::remove_sale(double price, order_id_t id) {
-    auto itr = sales.find(price);
-    assert(itr != sales.end());
-    if (itr != sales.end()) {
-        auto & order_ids = itr->second;
-        order_ids.erase(id);
-        if (order_ids.empty()) {
-            sales.erase(itr);
-        }
-    }
+void test_ns::order_book::mark_changes() {
+    mark_version = version;
+    bid_changes = {0, 0};
+    sale_changes = {0, 0};
 }
 
 /*
@@ -1024,11 +1567,11 @@ void test_ns::order_book::remove_sale(double price, order_id_t id) {
  */
 test_ns::optional_order test_ns::order_book::get_order(
         order_id_t id) const {
-    auto itr = orders.find(id);
-    if (itr == orders.end()) {
+    auto node = orders.find(id);
+    if (node == nullptr) {
         return std::make_pair(false, order_t());
     } else {
-        return std::make_pair(true, itr->second);
+        return std::make_pair(true, order_pool[*node].value);
     }
 }
 
@@ -1041,9 +1584,9 @@ void test_ns::order_book::get_price_levels(
     auto sales_itr = sales.begin();
     while (bids_itr != bids.end() && sales_itr != sales.end()) {
         volume_price_t bid_volume_price_level =
-                get_volume_price(bids_itr->first, bids_itr->second);
+                get_volume_price(bids_itr.price(), bids_itr.level());
         volume_price_t sale_volume_price_level =
-                get_volume_price(sales_itr->first, sales_itr->second);
+                get_volume_price(sales_itr.price(), sales_itr.level());
         callback(std::make_pair(true, bid_volume_price_level),
                 std::make_pair(true, sale_volume_price_level));
         ++bids_itr;
@@ -1052,7 +1595,7 @@ void test_ns::order_book::get_price_levels(
 
     while (bids_itr != bids.end()) {
         volume_price_t bid_volume_price_level =
-                get_volume_price(bids_itr->first, bids_itr->second);
+                get_volume_price(bids_itr.price(), bids_itr.level());
         volume_price_t sale_volume_price_level;
         callback(std::make_pair(true, bid_volume_price_level),
                 std::make_pair(false, sale_volume_price_level));
@@ -1062,7 +1605,7 @@ void test_ns::order_book::get_price_levels(
     while (sales_itr != sales.end()) {
         volume_price_t bid_volume_price_level;
         volume_price_t sale_volume_price_level =
-                get_volume_price(sales_itr->first, sales_itr->second);
+                get_volume_price(sales_itr.price(), sales_itr.level());
         callback(std::make_pair(false, bid_volume_price_level),
                 std::make_pair(true, sale_volume_price_level));
         ++sales_itr;
@@ -1074,31 +1617,15 @@ void test_ns::order_book::get_price_levels(
  */
 test_ns::volume_price_t
 test_ns::
-order_book::get_volume_price(double price, const order_ids_t& order_ids) const {
-    quantity_t total = 0;
-    for (auto const & id : order_ids) {
-        auto itr = orders.find(id);
-        assert(itr != orders.end());
-        if (itr != orders.end()) {
-            total += itr->second.quantity;
-        }
-    }
-    return test_ns::volume_price_t{total, price};
+order_book::get_volume_price(price_t price, const level_t& level) {
+    return test_ns::volume_price_t{level.volume, price};
 }
 
 test_ns::full_orders_t
 test_ns::
-order_book::get_line_full_orders(double price,
-        const order_ids_t& order_ids) const {
-    quantity_t total = 0;
-    for (auto const & id : order_ids) {
-        auto itr = orders.find(id);
-        assert(itr != orders.end());
-        if (itr != orders.end()) {
-            total += itr->second.quantity;
-        }
-    }
-    return test_ns::full_orders_t{true, order_ids.size(), total, price};
+order_book::get_line_full_orders(price_t price, const level_t& level) {
+    return test_ns::full_orders_t{true, level.orders,
+            level.volume, price};
 }
 
 /*
@@ -1109,25 +1636,25 @@ order_book::get_full_orders(get_full_orders_callback_t&& callback) const {
     auto bids_itr = bids.begin();
     auto sales_itr = sales.begin();
     while (bids_itr != bids.end() && sales_itr != sales.end()) {
-        full_orders_t bid = get_line_full_orders(bids_itr->first,
-                bids_itr->second);
-        full_orders_t ask = get_line_full_orders(sales_itr->first,
-                sales_itr->second);
+        full_orders_t bid = get_line_full_orders(bids_itr.price(),
+                bids_itr.level());
+        full_orders_t ask = get_line_full_orders(sales_itr.price(),
+                sales_itr.level());
         callback(bid, ask);
         ++bids_itr;
         ++sales_itr;
     }
     while (bids_itr != bids.end()) {
-        full_orders_t bid = get_line_full_orders(bids_itr->first,
-                bids_itr->second);
+        full_orders_t bid = get_line_full_orders(bids_itr.price(),
+                bids_itr.level());
         full_orders_t ask {false, 0, 0, 0};
         callback(bid, ask);
         ++bids_itr;
     }
     while (sales_itr != sales.end()) {
         full_orders_t bid = {false, 0, 0, 0};
-        full_orders_t ask = get_line_full_orders(sales_itr->first,
-                sales_itr->second);
+        full_orders_t ask = get_line_full_orders(sales_itr.price(),
+                sales_itr.level());
         callback(bid, ask);
         ++sales_itr;
     }
@@ -1138,20 +1665,20 @@ order_book::get_full_orders(get_full_orders_callback_t&& callback) const {
  */
 void test_ns::
 order_book::get_bbo(bbo_t* bbo) const {
-    if (bids.begin() == bids.end()) {
+    if (bids.empty()) {
         bbo->buy = std::make_pair(false, volume_price_t());
     } else {
         auto bids_itr = bids.begin();
         bbo->buy = std::make_pair(true,
-                get_volume_price(bids_itr->first, bids_itr->second));
+                get_volume_price(bids_itr.price(), bids_itr.level()));
     }
 
-    if (sales.begin() == sales.end()) {
+    if (sales.empty()) {
         bbo->sell = std::make_pair(false, volume_price_t());
     } else {
         auto sell_itr = sales.begin();
         bbo->sell = std::make_pair(true,
-                get_volume_price(sell_itr->first, sell_itr->second));
+                get_volume_price(sell_itr.price(), sell_itr.level()));
     }
 }
 
@@ -1160,74 +1687,18 @@ order_book::get_bbo(bbo_t* bbo) const {
  */
 void test_ns::
 order_book::get_vwap(quantity_t quantity, vwap_t* vwap) const {
-    vwap->quantity = quantity;
-    if (bids.begin() == bids.end()) {
-        vwap->buy = {false, 0.};
-    } else {
-        quantity_t found_quantity = 0;
-        double found_cost  = 0;
-        for (auto & a_group : bids) {
-            double current_price = a_group.first;
-            auto & order_ids = a_group.second;
-            for (auto order_id : order_ids)  {
-                auto itr = orders.find(order_id);
-                assert(itr != orders.end());
-                auto & order = itr->second;
-                assert(current_price == order.price);
-                assert(side_t::buy == order.side);
-                found_quantity += order.quantity;
-                if (found_quantity >= quantity) {
-                    auto diff = found_quantity - quantity;
-                    found_cost += (order.quantity-diff) * order.price;
-                    break;
-                } else {
-                    found_cost += order.quantity * order.price;
-                }
-            }
-            if (found_quantity >= quantity) {
-                break;
-            }
-        }
-        if (found_quantity >= quantity) {
-            double a_price = found_cost / quantity;
-            vwap->buy = {true, a_price};
-        } else {
-            vwap->buy = {false, 0.};
-        }
-    }
-    if (sales.begin() == sales.end()) {
-        vwap->sell = {false, 0.};
-    } else {
-        quantity_t found_quantity = 0;
-        double found_cost  = 0;
-        for (auto & a_group : sales) {
-            double current_price = a_group.first;
-            auto & order_ids = a_group.second;
-            for (auto order_id : order_ids)  {
-                auto itr = orders.find(order_id);
-                assert(itr != orders.end());
-                auto & order = itr->second;
-                assert(side_t::sell == order.side);
-                assert(current_price == order.price);
-                found_quantity += order.quantity;
-                if (found_quantity >= quantity) {
-                    auto diff = found_quantity - quantity;
-                    found_cost += (order.quantity-diff) * order.price;
-                    break;
-                } else {
-                    found_cost += order.quantity * order.price;
-                }
-            }
-            if (found_quantity >= quantity) {
-                break;
-            }
-        }
-        if (found_quantity >= quantity) {
-            double a_price = found_cost / quantity;
-            vwap->sell = {true, a_price};
-        } else {
-            vwap->buy = {false, 0. };
-        }
-    }
+    get_vwaps(&quantity, 1, vwap);
 }
 
+/*
+ * One walk down each side for all the quantities.
+ */
+void test_ns::
+order_book::get_vwaps(const quantity_t* quantities, size_t size,
+        vwap_t* vwaps) const {
+    for (size_t i = 0; i != size; ++i) {
+        vwaps[i].quantity = quantities[i];
+    }
+    get_levels_vwaps(bids, quantities, size, vwaps, &vwap_t::buy);
+    get_levels_vwaps(sales, quantities, size, vwaps, &vwap_t::sell);
+}
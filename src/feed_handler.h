@@ -7,14 +7,25 @@
 #include <set>
 #include <vector>
 #include <functional>
+#include <memory>
 #include <utility>
 
+#include "delimiter_scanner.h"
+#include "error_summary.h"
+#include "id_map.h"
+#include "node_pool.h"
+#include "output_sink.h"
+#include "price.h"
+#include "price_levels.h"
+#include "str_view.h"
+#include "symbol_table.h"
+
 namespace test_ns {
 
 /*
  *
  */
-enum class side_t {
+enum class side_t : uint8_t {
     buy,
     sell
 };
@@ -22,7 +33,7 @@ enum class side_t {
 /*
  *
  */
-enum class command_t {
+enum class command_t : uint8_t {
     none,
     order_add,
     order_modify,
@@ -35,6 +46,15 @@ enum class command_t {
     print_full
 };
 
+/*
+ * Result of the order_book calls addressing orders by id.
+ */
+enum class book_status_t {
+    ok,
+    duplicate_id,
+    unknown_id
+};
+
 /*
  *
  */
@@ -50,13 +70,54 @@ using quantity_t = uint64_t;
  */
 using symbol_t = std::string;
 
+/*
+ * A command with its arguments decoded, whatever the input format.
+ * Only the arguments of the given command are meaningful.
+ */
+struct command_args_t {
+    command_t command;
+    order_id_t id;
+    str_view_t symbol;
+    side_t side;
+    quantity_t quantity;
+    price_t price;
+};
+
+/*
+ * A line and the command parse_command() decoded from it, valid is
+ * false if the line is not a valid command.
+ */
+struct parsed_line_t {
+    str_view_t line;
+    command_args_t command;
+    bool valid;
+};
+
+/*
+ * A command as feed_handler applies it, with its symbol interned by
+ * feed_handler::intern_symbol() of the handler it is passed to, or only
+ * looked up by find_symbol() for an unsubscription or a print. It
+ * refers to no text, so a source other than a CSV feed can build it
+ * directly. Only the fields of the given command are meaningful, the
+ * symbol of a modify, a cancel or a command on an unknown symbol is
+ * no_symbol.
+ */
+struct command_record_t {
+    order_id_t id;
+    quantity_t quantity;
+    price_t price;
+    symbol_id_t symbol;
+    command_t command;
+    side_t side;
+};
+
 /*
  *
  */
 struct order_t {
     order_id_t id;
     quantity_t quantity;
-    double price;
+    price_t price;
     side_t side;
 };
 using optional_order = std::pair<bool, order_t>;
@@ -66,7 +127,7 @@ using optional_order = std::pair<bool, order_t>;
  */
 struct volume_price_t {
     quantity_t volume;
-    double price;
+    price_t price;
 };
 using price_level_t = std::pair<bool, volume_price_t>;
 using get_price_levels_callback_t =
@@ -81,11 +142,14 @@ struct bbo_t {
 };
 
 /*
- *
+ * Cost of vwap_t::quantity on one side of the book. It stays an exact
+ * sum of ticks until printed, see notional_to_double(). reach is the
+ * price of the last level the quantity takes from.
  */
 struct optional_price_t {
     bool valid;
-    double price;
+    notional_t notional;
+    price_t reach;
 };
 
 struct vwap_t {
@@ -101,43 +165,86 @@ struct full_orders_t {
     bool valid;
     size_t orders;
     quantity_t volume;
-    double price;
+    price_t price;
 };
 
 using get_full_orders_callback_t =
         std::function<void(const full_orders_t& bid, const full_orders_t& ask)>;
 
 /*
- *
+ * Changes to the levels of one side of a book since the last
+ * order_book::mark_changes(): how many and the best price among them.
+ */
+struct side_changes_t {
+    uint64_t count;
+    price_t best_price;
+};
+
+/*
+ * Orders can be addressed by id or by the node an order got when it
+ * was inserted. The id calls keep an index of their own and return
+ * book_status_t rather than throw on an id that is already there or
+ * not there, the book is then left as it was. feed_handler indexes the
+ * orders of all books in one place and uses the node calls.
  */
 class order_book {
  public:
-    explicit order_book(const symbol_t& symbol);
+    explicit order_book(const symbol_t& symbol,
+            const book_config_t& config = book_config_t());
     const symbol_t& get_symbol() const;
-    void add_order(order_id_t id, side_t, quantity_t, double);
+    book_status_t add_order(order_id_t id, side_t, quantity_t, price_t);
     optional_order get_order(order_id_t id) const;
-    void modify_order(order_id_t id, quantity_t, double);
-    void cancel_order(order_id_t id);
+    book_status_t modify_order(order_id_t id, quantity_t, price_t);
+    book_status_t cancel_order(order_id_t id);
+    node_index_t insert_order(const order_t&);
+    const order_t& get_order_at(node_index_t) const;
+    void modify_order_at(node_index_t, quantity_t, price_t);
+    void erase_order_at(node_index_t);
     void get_price_levels(get_price_levels_callback_t&&) const;
     void get_full_orders(get_full_orders_callback_t&&) const;
     void get_bbo(bbo_t* best_bid_offer) const;
     void get_vwap(quantity_t, vwap_t*) const;
+    void get_vwaps(const quantity_t* sorted_quantities, size_t size,
+            vwap_t*) const;
+    /*
+     * Changes whenever an order is added to or removed from a level.
+     */
+    uint64_t get_version() const {
+        return version;
+    }
+    /*
+     * The version the book had at the last mark_changes().
+     */
+    uint64_t get_mark_version() const {
+        return mark_version;
+    }
+    const side_changes_t& get_changes(side_t side) const {
+        return side == side_t::buy ? bid_changes : sale_changes;
+    }
+    bool is_changed_up_to(side_t, price_t) const;
+    void mark_changes();
 
  private:
-    using orders_t = std::unordered_map<order_id_t, order_t>;
-    using order_ids_t = std::set<order_id_t>;
-    using bids_t = std::map<double, order_ids_t, std::greater<double>>;
-    using sales_t = std::map<double, order_ids_t>;
+    using order_pool_t = node_pool<order_t>;
+    using orders_t = id_map<node_index_t>;
+    using level_t = book_level_t;
+    using bids_t = price_levels<std::greater<price_t>>;
+    using sales_t = price_levels<std::less<price_t>>;
     symbol_t symbol;
+    order_pool_t order_pool;
     orders_t orders;
     bids_t bids;
     sales_t sales;
-    void add_bid(double, order_id_t);
-    void add_sale(double, order_id_t);
-    void remove_bid(double, order_id_t);
-    void remove_sale(double, order_id_t);
-    volume_price_t get_volume_price(double price, const order_ids_t&) const;
-    full_orders_t get_line_full_orders(double price, const order_ids_t&) const;
+    uint64_t version;
+    uint64_t mark_version;
+    side_changes_t bid_changes;
+    side_changes_t sale_changes;
+    void add_to_level(node_index_t);
+    void note_change(side_t, price_t);
+    void remove_from_level(node_index_t);
+    static volume_price_t get_volume_price(price_t price, const level_t&);
+    static full_orders_t get_line_full_orders(price_t price,
+            const level_t&);
 };
 
 using callback_t =
@@ -146,13 +253,61 @@ using err_callback_t =
         std::function<void(const std::string&, const std::string&)>;
 
 /*
- *
+ * Symbols are interned into a symbol_table once per command. Every
+ * symbol id has an entry with its book and the subscriptions to it.
+ * Subscribed symbols are kept in sets ordered by symbol name, which
+ * is the order subscriptions are printed in.
  */
 class feed_handler {
  public:
     feed_handler(const symbol_t& selected_symbol,
-            callback_t&&, err_callback_t&&);
-    void process_command(const std::string&);
+            callback_t&&, err_callback_t&&,
+            const book_config_t& config = book_config_t());
+    feed_handler(const symbol_t& selected_symbol,
+            output_sink*, err_callback_t&&,
+            const book_config_t& config = book_config_t());
+    void process_command(const str_view_t&);
+    /*
+     * commas are the ones of line, as delimiter_scanner finds them
+     */
+    void process_command(const str_view_t& line, const line_commas_t&);
+    void process_command(const command_args_t&);
+    void process_command(const command_args_t&, const str_view_t& line);
+    void process(const command_record_t&);
+    /*
+     * process() of a record decoded from line, errors quote the line as
+     * process_command() of the line would.
+     */
+    void process(const command_record_t&, const str_view_t& line);
+    void process_batch(const command_record_t* records, size_t size);
+    symbol_id_t intern_symbol(const str_view_t&);
+    symbol_id_t find_symbol(const str_view_t&) const;
+    command_record_t to_record(const command_args_t&);
+    void set_error_summary(error_summary*);
+    /*
+     * For a caller which merges the output of feed_handlers that hold
+     * different symbols, see sharded_feed_handler.
+     */
+    bool apply_line(const str_view_t&, str_view_t* symbol = nullptr);
+    bool apply_line(const str_view_t&, const line_commas_t&,
+            str_view_t* symbol = nullptr);
+    void print_symbol_bbo(const str_view_t& symbol, output_sink*);
+    void print_symbol_vwaps(const str_view_t& symbol, output_sink*);
+    static const char* parse_command(const str_view_t& line,
+            const str_view_t& selected_symbol, command_args_t*);
+    static const char* parse_command(const str_view_t& line,
+            const line_commas_t&, const str_view_t& selected_symbol,
+            command_args_t*);
+    static std::string format_command(const command_args_t&);
+    /*
+     * For a caller which parses lines ahead on other threads, see
+     * replay_pipeline and chunked_replay.
+     */
+    static void parse_line(const str_view_t& line,
+            const str_view_t& selected_symbol, parsed_line_t*);
+    static void parse_line(const str_view_t& line, const line_commas_t&,
+            const str_view_t& selected_symbol, parsed_line_t*);
+    void process_parsed(const parsed_line_t&);
 
     bool is_there_selected_symbol() const;
     symbol_t get_selected_symbol() const;
@@ -164,48 +319,160 @@ class feed_handler {
     unsigned get_bbo_subs_number(const symbol_t&) const;
     unsigned get_total_number_vwap_subs() const;
     unsigned get_vwap_subs_number(const symbol_t&, quantity_t) const;
+    uint64_t get_avoided_vwaps_number() const;
 
  private:
-    using order_books_t = std::unordered_map<symbol_t, order_book>;
-    using order_id_symbols_t = std::unordered_map<order_id_t, symbol_t>;
-    using bbo_subs_t = std::map<symbol_t, int>;
-    using vwap_subs_t = std::map<std::pair<symbol_t, quantity_t>, int>;
-    using vwap_key_t = std::pair<symbol_t, quantity_t>;
-    using args_t = std::vector<std::string>;
-    callback_t callback;
+    /*
+     * Where a live order rests, its book and its node in the book.
+     */
+    struct order_ref_t {
+        order_book* book;
+        node_index_t node;
+    };
+    using order_refs_t = id_map<order_ref_t>;
+    using name_less_t = symbol_table::name_less_t;
+    /*
+     * A subscription and the line last printed for it, which is printed
+     * again while its book has the same version. A VWAP line also holds
+     * while no level it took from changed, see is_reach_unchanged().
+     */
+    struct subscription_t {
+        int count;
+        bool cached;
+        const order_book* book;
+        uint64_t version;
+        std::string line;
+        // the reach of a VWAP line on each side, valid if it was filled
+        std::pair<bool, price_t> buy_reach;
+        std::pair<bool, price_t> sell_reach;
+        subscription_t()
+            : count(0), cached(false), book(nullptr), version(0),
+              buy_reach(false, 0), sell_reach(false, 0) {}
+        bool is_cached(const order_book* a_book) const {
+            return cached && book == a_book &&
+                    (book == nullptr || version == book->get_version());
+        }
+        /*
+         * Whether a VWAP line up to date at the last mark of its book
+         * still is: the book changes since the mark are checked against
+         * its reach. A side the quantity did not fill must not have
+         * changed at all.
+         */
+        bool is_reach_unchanged(const order_book* a_book) const {
+            return cached && book == a_book && book != nullptr &&
+                    version == book->get_mark_version() &&
+                    is_side_unchanged(side_t::buy, buy_reach) &&
+                    is_side_unchanged(side_t::sell, sell_reach);
+        }
+        bool is_side_unchanged(side_t side,
+                const std::pair<bool, price_t>& reach) const {
+            return reach.first ? !book->is_changed_up_to(side, reach.second) :
+                    book->get_changes(side).count == 0;
+        }
+        void cache(const order_book* a_book, const str_view_t& a_line) {
+            cached = true;
+            book = a_book;
+            version = book == nullptr ? 0 : book->get_version();
+            line.assign(a_line.data, a_line.size);
+        }
+    };
+    using vwap_subs_t = std::map<quantity_t, subscription_t>;
+    /*
+     * A symbol: its book, nullptr until the symbol has an order, and
+     * its subscriptions, the BBO one is there while bbo.count > 0.
+     */
+    struct symbol_entry_t {
+        std::unique_ptr<order_book> book;
+        subscription_t bbo;
+        vwap_subs_t vwaps;
+    };
+    using symbol_entries_t = std::vector<symbol_entry_t>;
+    using symbol_set_t = std::set<symbol_id_t, name_less_t>;
+    /*
+     * Arguments of a command line, views into the line itself.
+     */
+    struct args_t {
+        static const unsigned max_size = 5;
+        str_view_t values[max_size];
+        unsigned size;
+        const str_view_t& operator[](unsigned i) const { return values[i]; }
+    };
+    std::unique_ptr<output_sink> own_output;
+    output_sink* output;
     err_callback_t err_callback;
+    error_summary* errors;
     symbol_t selected_symbol;
-    order_books_t order_books;
-    order_id_symbols_t order_id_symbols;
-    bbo_subs_t bbo_subs;
-    vwap_subs_t vwap_subs;
-    command_t parse_command(const std::string& line);
-    bool parse_args(const std::string& line, unsigned number, args_t*) const;
-    void process_order_add(const std::string& line);
-    void process_order_modify(const std::string& line);
-    void process_order_cancel(const std::string& line);
-    void process_subs_bbo(const std::string& line);
-    void process_unsubs_bbo(const std::string& line);
-    void process_subs_vwap(const std::string& line);
-    void process_unsubs_vwap(const std::string& line);
-    void decrement_bbo(const symbol_t&);
-    void print_bbo_subs() const;
-    void print_vwap_subs() const;
-    static bool str_to_order_id(const std::string&, order_id_t*);
-    static bool str_to_symbol(const std::string&, symbol_t*);
-    static bool str_to_side(const std::string&, side_t*);
-    static bool str_to_quantity(const std::string&, quantity_t*);
-    static bool str_to_price(const std::string&, double*);
-    bool should_handle_symbol(const std::string&) const;
-    order_book& get_order_book(const std::string&);
-    bool is_there_order_book(const std::string&) const;
-    const order_book& get_order_book_ref(const std::string&) const;
-    order_book& get_order_book_ref(const std::string&);
-    void print(const symbol_t& symbol) const;
-    void print_full(const symbol_t& symbol) const;
-    bool is_there_order_book(const order_id_t&) const;
-    order_book& get_order_book_ref(const order_id_t&);
-    const order_book& get_order_book_ref(const order_id_t&) const;
+    book_config_t book_config;
+    // on the heap, so that the comparators of the symbol sets can
+    // point to it while feed_handler is moved
+    std::unique_ptr<symbol_table> symbols;
+    symbol_id_t selected_symbol_id;
+    symbol_entries_t entries;
+    order_refs_t order_refs;
+    symbol_set_t bbo_symbols;
+    symbol_set_t vwap_symbols;
+    // scratch space of print_vwap_subs(), reused between commands
+    std::vector<quantity_t> vwap_quantities;
+    std::vector<vwap_t> vwap_results;
+    uint64_t avoided_vwaps;
+    static command_t parse_command_name(const str_view_t& line,
+            const line_commas_t&);
+    static bool parse_args(const str_view_t& line, const line_commas_t&,
+            unsigned number, args_t*);
+    static const char* parse_order_add(const str_view_t& line,
+            const line_commas_t&, const str_view_t& selected_symbol,
+            command_args_t*);
+    static const char* parse_order_modify(const str_view_t& line,
+            const line_commas_t&, command_args_t*);
+    static const char* parse_order_cancel(const str_view_t& line,
+            const line_commas_t&, command_args_t*);
+    static const char* parse_symbol_command(const str_view_t& line,
+            const line_commas_t&, const str_view_t& selected_symbol,
+            command_args_t*);
+    static const char* parse_vwap_command(const str_view_t& line,
+            const line_commas_t&, const str_view_t& selected_symbol,
+            command_args_t*);
+    command_args_t to_args(const command_record_t&) const;
+    void process_record(const command_record_t&, const str_view_t* line);
+    bool is_valid_record(const command_record_t&) const;
+    void apply_record(const command_record_t&, const str_view_t* line);
+    void order_add(const command_record_t&, const str_view_t* line);
+    void order_modify(const command_record_t&, const str_view_t* line);
+    void order_cancel(const command_record_t&, const str_view_t* line);
+    void subs_bbo(const command_record_t&);
+    void subs_vwap(const command_record_t&);
+    void unsubs_vwap(const command_record_t&);
+    void decrement_bbo(symbol_id_t);
+    void print_subs();
+    void print_bbo_subs();
+    void print_bbo(symbol_id_t, output_sink*);
+    void print_vwap_subs();
+    void print_vwaps(symbol_id_t, output_sink*);
+    void print_vwap(symbol_id_t, const order_book*, const vwap_t&,
+            subscription_t*, output_sink*);
+    static bool str_to_order_id(const str_view_t&, order_id_t*);
+    static bool str_to_symbol(const str_view_t&, str_view_t*);
+    static bool str_to_side(const str_view_t&, side_t*);
+    static bool str_to_quantity(const str_view_t&, quantity_t*);
+    static bool str_to_price(const str_view_t&, price_t*);
+    str_view_t get_command_symbol(const command_args_t&) const;
+    bool should_handle_symbol(symbol_id_t) const;
+    static bool is_symbol_selected(const str_view_t& selected_symbol,
+            const str_view_t& symbol);
+    symbol_entry_t& get_entry(symbol_id_t);
+    const symbol_entry_t* find_entry(symbol_id_t) const;
+    order_book& get_order_book(symbol_id_t);
+    const order_book* find_order_book(symbol_id_t) const;
+    void print(symbol_id_t) const;
+    void print_full(symbol_id_t) const;
+    bool should_report(error_category_t) const;
+    void report_error(const str_view_t& line, const char* err) const;
+    void report_error(const command_record_t&, const str_view_t* line,
+            error_category_t, const char* err) const;
+    void report_order_error(const command_record_t&, const str_view_t* line,
+            error_category_t, const char* err) const;
+    void call_err_callback(const command_record_t&, const str_view_t* line,
+            const char* err) const;
 };
 
 /*
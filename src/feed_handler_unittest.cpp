@@ -10,6 +10,18 @@
 test_ns::symbol_t test_symbol_1 = "S1";
 test_ns::symbol_t test_symbol_2 = "S2";
 
+/*
+ *
+ */
+test_ns::price_t to_price(double value) {
+    return test_ns::double_to_price(value);
+}
+
+double vwap_price(const test_ns::vwap_t& vwap,
+        const test_ns::optional_price_t& side) {
+    return test_ns::notional_to_double(side.notional, vwap.quantity);
+}
+
 /*
  *
  */
@@ -101,6 +113,65 @@ TEST(FeedHandler, CreateWithEmptyCallback) {
     }
 }
 
+/*
+ * Without an error callback bad commands are skipped silently.
+ */
+TEST(FeedHandler, NoErrorCallback) {
+    try {
+        test_callback_t a_test_object;
+        test_ns::callback_t
+            a_callback = std::bind(&test_callback_t::ok_func,
+                    &a_test_object, std::placeholders::_1);
+        test_ns::feed_handler a_handler("",
+                std::move(a_callback), test_ns::err_callback_t());
+        a_handler.process_command("ORDER ADD,1,S1,Buy,10,72.82");
+        a_handler.process_command("ORDER ADD,1,S1,Buy,10,72.82");
+        a_handler.process_command("ORDER MODIFY,2,10,72.82");
+        a_handler.process_command("ORDER CANCEL,2");
+        a_handler.process_command("ORDER CANCEL");
+        test_ns::command_args_t command{test_ns::command_t::order_cancel, 3,
+                test_ns::str_view_t(), test_ns::side_t::buy, 0, 0};
+        a_handler.process_command(command);
+        a_handler.process_command("PRINT,S1");
+        ASSERT_EQ(a_test_object.output.size(), 1);
+        ASSERT_EQ(a_handler.get_order("S1", 1).second.quantity, 10);
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+/*
+ * With an error summary only the first errors of a category reach the
+ * error callback, all of them are counted.
+ */
+TEST(FeedHandler, ErrorSummary) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        test_ns::error_summary summary(1);
+        a_handler.set_error_summary(&summary);
+        a_handler.process_command("ORDER ADD,1,S1,Buy,10,72.82");
+        a_handler.process_command("ORDER ADD,1,S1,Buy,10,72.82");
+        a_handler.process_command("ORDER CANCEL,2");
+        a_handler.process_command("ORDER MODIFY,3,10,72.82");
+        a_handler.process_command("ORDER SKIP,2");
+        a_handler.process_command("ORDER SKIP,3");
+        a_handler.process_command("ORDER ADD,4,S1,Buy,10,x");
+        ASSERT_EQ(a_test_object.errors.size(), 4);
+        ASSERT_EQ(a_test_object.errors[1].first, "ORDER CANCEL,2");
+        ASSERT_EQ(a_test_object.errors[2].first, "ORDER SKIP,2");
+        ASSERT_EQ(summary.get_count(
+                test_ns::error_category_t::duplicate_order), 1);
+        ASSERT_EQ(summary.get_count(
+                test_ns::error_category_t::unknown_order), 2);
+        ASSERT_EQ(summary.get_count(
+                test_ns::error_category_t::incorrect_command), 2);
+        ASSERT_EQ(summary.get_count(
+                test_ns::error_category_t::invalid_value), 1);
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
 TEST(FeedHandler, CreateWithDefCallback) {
     try {
         test_ns::callback_t
@@ -239,6 +310,30 @@ TEST(FeedHandler, OrderAddMoreParams2) {
     }
 }
 
+/*
+ * More commas than a command can have are not all kept by the tokenizer.
+ */
+TEST(FeedHandler, OrderAddManyCommas) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("ORDER ADD,1,S1,Buy,20,3.33,,,,,,,");
+        CHECK_INVALID_NUMBER_OF_PARAMS;
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST(FeedHandler, OrderAddTrailingComma) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("ORDER ADD,1,S1,Buy,20,3.33,");
+        a_handler.process_command("ORDER CANCEL,1");
+        ASSERT_TRUE(a_test_object.errors.empty());
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
 TEST(FeedHandler, OrderAddBuy) {
     try {
         CREATE_DEFAULT_TEST_HANDLER;
@@ -248,7 +343,7 @@ TEST(FeedHandler, OrderAddBuy) {
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 3.33);
+        ASSERT_EQ(order_1.second.price, to_price(3.33));
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -263,7 +358,7 @@ TEST(FeedHandler, OrderAddSell) {
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::sell);
         ASSERT_EQ(order_1.second.quantity, 30);
-        ASSERT_EQ(order_1.second.price, 4.33);
+        ASSERT_EQ(order_1.second.price, to_price(4.33));
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -278,7 +373,7 @@ TEST(FeedHandler, SelectedSymbolOrderAddBuy) {
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 3.33);
+        ASSERT_EQ(order_1.second.price, to_price(3.33));
     } catch (std::exception& e) {
         FAIL() << "Exception caught: " << e.what();
     }
@@ -309,7 +404,7 @@ TEST(FeedHandler, OrderAddBuyDuplicate) {
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 3.33);
+        ASSERT_EQ(order_1.second.price, to_price(3.33));
 
         ASSERT_TRUE(a_test_object.errors.empty());
         a_handler.process_command("ORDER ADD,1,S1,Sell,30,4.33");
@@ -318,7 +413,7 @@ TEST(FeedHandler, OrderAddBuyDuplicate) {
         ASSERT_TRUE(order_2.first);
         ASSERT_EQ(order_2.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_2.second.quantity, 20);
-        ASSERT_EQ(order_2.second.price, 3.33);
+        ASSERT_EQ(order_2.second.price, to_price(3.33));
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -328,7 +423,7 @@ TEST(FeedHandler, OrderAddBuyTwoSymbols) {
     try {
         CREATE_DEFAULT_TEST_HANDLER;
         a_handler.process_command("ORDER ADD,1,S1,Buy,20,3.33");
-        a_handler.process_command("ORDER ADD,1,S2,Sell,30,4.33");
+        a_handler.process_command("ORDER ADD,2,S2,Sell,30,4.33");
         ASSERT_TRUE(a_test_object.output.empty());
         ASSERT_EQ(a_test_object.errors.size(), 0);
 
@@ -336,13 +431,22 @@ TEST(FeedHandler, OrderAddBuyTwoSymbols) {
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 3.33);
+        ASSERT_EQ(order_1.second.price, to_price(3.33));
+        ASSERT_FALSE(a_handler.get_order(test_symbol_2, 1).first);
 
-        auto order_2 = a_handler.get_order(test_symbol_2, 1);
+        auto order_2 = a_handler.get_order(test_symbol_2, 2);
         ASSERT_TRUE(order_2.first);
         ASSERT_EQ(order_2.second.side, test_ns::side_t::sell);
         ASSERT_EQ(order_2.second.quantity, 30);
-        ASSERT_EQ(order_2.second.price, 4.33);
+        ASSERT_EQ(order_2.second.price, to_price(4.33));
+
+        // order ids are unique across symbols
+        a_handler.process_command("ORDER ADD,1,S2,Sell,30,4.33");
+        ASSERT_EQ(a_test_object.errors.size(), 1);
+        ASSERT_EQ(a_test_object.errors[0].second,
+                "failed to add: This order already exist: 1");
+        ASSERT_FALSE(a_handler.get_order(test_symbol_2, 1).first);
+        ASSERT_STREQ(a_handler.get_symbol_for_order(1).c_str(), "S1");
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -392,7 +496,7 @@ TEST(FeedHandler, OrderModifyBuy) {
         ASSERT_TRUE(a_test_object.errors.empty());
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 3.33);
+        ASSERT_EQ(order_1.second.price, to_price(3.33));
 
         a_handler.process_command("ORDER MODIFY,1,30,4.01");
         ASSERT_STREQ(a_handler.get_symbol_for_order(1).c_str(), "S1");
@@ -401,7 +505,7 @@ TEST(FeedHandler, OrderModifyBuy) {
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 30);
-        ASSERT_EQ(order_1.second.price, 4.01);
+        ASSERT_EQ(order_1.second.price, to_price(4.01));
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -427,6 +531,46 @@ TEST(FeedHandler, OrderCancelInvalidNumParams2) {
     }
 }
 
+TEST(FeedHandler, OrderCancelInvalidNumParams3) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("ORDER CANCEL,1,,");
+        CHECK_INVALID_NUMBER_OF_PARAMS;
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST(FeedHandler, OrderCancelTrailingComma) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("ORDER ADD,1,S1,Buy,20,3.33,");
+        ASSERT_TRUE(a_test_object.errors.empty());
+        ASSERT_TRUE(a_handler.is_there_symbol_for_order(1));
+        a_handler.process_command("ORDER CANCEL,1,");
+        ASSERT_TRUE(a_test_object.errors.empty());
+        ASSERT_FALSE(a_handler.is_there_symbol_for_order(1));
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST(FeedHandler, CommandPrefix) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("ORDER ADDX,1,S1,Buy,20,3.33");
+        a_handler.process_command("PRINT_FUL,S1");
+        ASSERT_TRUE(a_test_object.output.empty());
+        ASSERT_EQ(a_test_object.errors.size(), 2);
+        ASSERT_STREQ(a_test_object.errors[0].second.c_str(),
+                "incorrect command");
+        ASSERT_STREQ(a_test_object.errors[1].second.c_str(),
+                "incorrect command");
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
 TEST(FeedHandler, OrderCancelInvalidID) {
     try {
         CREATE_DEFAULT_TEST_HANDLER;
@@ -451,7 +595,7 @@ TEST(FeedHandler, OrderCancelBuy) {
         ASSERT_TRUE(a_test_object.errors.empty());
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 3.33);
+        ASSERT_EQ(order_1.second.price, to_price(3.33));
 
         a_handler.process_command("ORDER MODIFY,1,30,4.01");
         ASSERT_STREQ(a_handler.get_symbol_for_order(1).c_str(), "S1");
@@ -460,7 +604,7 @@ TEST(FeedHandler, OrderCancelBuy) {
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 30);
-        ASSERT_EQ(order_1.second.price, 4.01);
+        ASSERT_EQ(order_1.second.price, to_price(4.01));
 
         a_handler.process_command("ORDER CANCEL,1");
         ASSERT_FALSE(a_handler.is_there_symbol_for_order(1));
@@ -1110,6 +1254,180 @@ TEST(FeedHandler, SubsAddOrderUnsubsVWAP) {
     }
 }
 
+/*
+ * The line of an unchanged book is printed from the cache, the line of
+ * the changed one is formatted again.
+ */
+TEST(FeedHandler, SubsCachedLines) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("ORDER ADD,1,S1,Buy,10,72.82");
+        a_handler.process_command("ORDER ADD,2,S2,Sell,20,10.5");
+        a_handler.process_command("SUBSCRIBE BBO,S2");
+        a_handler.process_command("SUBSCRIBE BBO,S1");
+        a_handler.process_command("SUBSCRIBE VWAP,S1,5");
+        a_handler.process_command("SUBSCRIBE VWAP,S3,5");
+        a_test_object.output.clear();
+
+        a_handler.process_command("ORDER MODIFY,2,30,10.25");
+        a_handler.process_command("ORDER ADD,3,S1,Buy,10,72.83");
+        a_handler.process_command("ORDER CANCEL,3");
+        ASSERT_TRUE(a_test_object.errors.empty());
+        std::vector<std::string> line = {
+                "BBO: S1        10@72.82             |                     ",
+                "BBO: S2                             | 30@10.25            ",
+                "VWAP: S1         <72.82,NIL>",
+                "VWAP: S3         <NIL,NIL>",
+                "BBO: S1        10@72.83             |                     ",
+                "VWAP: S1         <72.83,NIL>"};
+        ASSERT_EQ(a_test_object.output, (std::vector<std::string>{
+                line[0], line[1], line[2], line[3],
+                line[4], line[1], line[5], line[3],
+                line[0], line[1], line[2], line[3]}));
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+/*
+ * A VWAP is computed again only for a change at or inside the levels it
+ * took from, or on a side its quantity did not fill.
+ */
+TEST(FeedHandler, SubsVwapReach) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("ORDER ADD,1,S1,Buy,10,72.82");
+        a_handler.process_command("ORDER ADD,2,S1,Buy,10,72");
+        a_handler.process_command("ORDER ADD,3,S1,Sell,10,73");
+        a_handler.process_command("SUBSCRIBE VWAP,S1,5");
+        a_test_object.output.clear();
+        ASSERT_EQ(a_handler.get_avoided_vwaps_number(), 0);
+
+        a_handler.process_command("ORDER ADD,4,S1,Buy,10,71");
+        a_handler.process_command("ORDER CANCEL,2");
+        ASSERT_EQ(a_handler.get_avoided_vwaps_number(), 2);
+        a_handler.process_command("ORDER ADD,5,S1,Sell,1,72.9");
+        ASSERT_EQ(a_handler.get_avoided_vwaps_number(), 2);
+        a_handler.process_command("SUBSCRIBE VWAP,S1,100");
+        a_handler.process_command("ORDER ADD,6,S1,Sell,5,80");
+        ASSERT_EQ(a_handler.get_avoided_vwaps_number(), 3);
+        ASSERT_TRUE(a_test_object.errors.empty());
+        std::vector<std::string> line = {
+                "VWAP: S1         <72.82,73>",
+                "VWAP: S1         <72.82,72.98>",
+                "VWAP: S1         <NIL,NIL>"};
+        ASSERT_EQ(a_test_object.output, (std::vector<std::string>{
+                line[0], line[0], line[1],
+                line[1], line[2], line[1], line[2]}));
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+/*
+ * Records built without text give the output of the same lines.
+ */
+TEST(FeedHandler, ProcessRecord) {
+    try {
+        ASSERT_EQ(sizeof(test_ns::command_record_t), 32);
+        CREATE_DEFAULT_TEST_HANDLER;
+        test_ns::symbol_id_t s1 = a_handler.intern_symbol("S1");
+        test_ns::command_record_t records[] = {
+            {0, 0, 0, s1, test_ns::command_t::subs_bbo,
+                test_ns::side_t::buy},
+            {0, 10, 0, s1, test_ns::command_t::subs_vwap,
+                test_ns::side_t::buy},
+            {1, 10, to_price(72.82), s1, test_ns::command_t::order_add,
+                test_ns::side_t::buy},
+            {1, 10, to_price(72.82), s1, test_ns::command_t::order_add,
+                test_ns::side_t::buy},
+            {1, 20, to_price(72.83), test_ns::no_symbol,
+                test_ns::command_t::order_modify, test_ns::side_t::buy},
+            {2, 0, 0, test_ns::no_symbol,
+                test_ns::command_t::order_cancel, test_ns::side_t::buy},
+            {0, 0, 0, s1, test_ns::command_t::print,
+                test_ns::side_t::buy}};
+        a_handler.process_batch(records, 7);
+
+        test_callback_t expected;
+        test_ns::feed_handler a_line_handler("",
+                std::bind(&test_callback_t::ok_func, &expected,
+                    std::placeholders::_1),
+                std::bind(&test_callback_t::err_func, &expected,
+                    std::placeholders::_1, std::placeholders::_2));
+        for (const char* line : {"SUBSCRIBE BBO,S1", "SUBSCRIBE VWAP,S1,10",
+                "ORDER ADD,1,S1,Buy,10,72.82", "ORDER ADD,1,S1,Buy,10,72.82",
+                "ORDER MODIFY,1,20,72.83", "ORDER CANCEL,2", "PRINT,S1"}) {
+            a_line_handler.process_command(line);
+        }
+        ASSERT_EQ(a_test_object.output, expected.output);
+        ASSERT_EQ(a_test_object.errors, expected.errors);
+        ASSERT_EQ(a_test_object.errors.size(), 2);
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+/*
+ * A symbol id the handler did not give out is an error, an unknown
+ * symbol is no_symbol for commands which do not add it.
+ */
+TEST(FeedHandler, ProcessRecordSymbol) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process({1, 10, to_price(1), 5,
+                test_ns::command_t::order_add, test_ns::side_t::buy});
+        ASSERT_EQ(a_test_object.errors.size(), 1);
+        ASSERT_EQ(a_test_object.errors[0].second, "invalid symbol id");
+        ASSERT_FALSE(a_handler.is_there_symbol_for_order(1));
+
+        test_ns::command_args_t command{test_ns::command_t::print, 0, "S9",
+            test_ns::side_t::buy, 0, 0};
+        auto record = a_handler.to_record(command);
+        ASSERT_EQ(record.symbol, test_ns::no_symbol);
+        a_handler.process(record);
+        command.command = test_ns::command_t::subs_bbo;
+        ASSERT_EQ(a_handler.to_record(command).symbol,
+                a_handler.intern_symbol("S9"));
+        ASSERT_EQ(a_test_object.errors.size(), 1);
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+/*
+ * Subscriptions are printed by symbol name and quantity, whatever the
+ * order they were made in.
+ */
+TEST(FeedHandler, SubsPrintOrder) {
+    try {
+        CREATE_DEFAULT_TEST_HANDLER;
+        a_handler.process_command("SUBSCRIBE VWAP,S2,10");
+        a_handler.process_command("SUBSCRIBE VWAP,S1,20");
+        a_handler.process_command("SUBSCRIBE VWAP,S1,5");
+        a_handler.process_command("SUBSCRIBE VWAP,S3,1");
+        a_handler.process_command("UNSUBSCRIBE VWAP,S3,1");
+        a_handler.process_command("UNSUBSCRIBE VWAP,S4,1");
+        a_handler.process_command("ORDER ADD,1,S2,Buy,10,1");
+        a_handler.process_command("SUBSCRIBE BBO,S2");
+        a_handler.process_command("SUBSCRIBE BBO,S1");
+        ASSERT_EQ(a_handler.get_total_number_vwap_subs(), 3);
+        ASSERT_EQ(a_handler.get_total_number_bbo_subs(), 2);
+        a_test_object.output.clear();
+
+        a_handler.process_command("ORDER ADD,2,S1,Sell,10,2");
+        ASSERT_TRUE(a_test_object.errors.empty());
+        ASSERT_EQ(a_test_object.output, (std::vector<std::string>{
+                "BBO: S1                             | 10@2                ",
+                "BBO: S2        10@1                 |                     ",
+                "VWAP: S1         <NIL,2>",
+                "VWAP: S1         <NIL,NIL>",
+                "VWAP: S2         <1,NIL>"}));
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
 TEST(FeedHandler, SelectedSymbolOrderAddBuy2) {
     try {
         CREATE_SYMBOL_TEST_HANDLER(test_symbol_2);
@@ -1134,35 +1452,76 @@ TEST(OrderBook, Create) {
     }
 }
 
+TEST(OrderBook, Version) {
+    test_ns::order_book an_order_book{test_symbol_1};
+    auto version = an_order_book.get_version();
+    an_order_book.add_order(1, test_ns::side_t::buy, 10, 100);
+    ASSERT_NE(an_order_book.get_version(), version);
+    version = an_order_book.get_version();
+    ASSERT_EQ(an_order_book.cancel_order(2),
+            test_ns::book_status_t::unknown_id);
+    ASSERT_EQ(an_order_book.get_version(), version);
+    an_order_book.modify_order(1, 20, 100);
+    ASSERT_NE(an_order_book.get_version(), version);
+    version = an_order_book.get_version();
+    an_order_book.cancel_order(1);
+    ASSERT_NE(an_order_book.get_version(), version);
+}
+
+TEST(OrderBook, Changes) {
+    test_ns::order_book an_order_book{test_symbol_1};
+    an_order_book.add_order(1, test_ns::side_t::buy, 10, 100);
+    an_order_book.add_order(2, test_ns::side_t::buy, 10, 90);
+    ASSERT_EQ(an_order_book.get_changes(test_ns::side_t::buy).count, 2);
+    ASSERT_EQ(an_order_book.get_changes(test_ns::side_t::sell).count, 0);
+    ASSERT_TRUE(an_order_book.is_changed_up_to(test_ns::side_t::buy, 100));
+    ASSERT_FALSE(an_order_book.is_changed_up_to(test_ns::side_t::buy, 101));
+    ASSERT_FALSE(an_order_book.is_changed_up_to(test_ns::side_t::sell, 0));
+    an_order_book.mark_changes();
+    ASSERT_EQ(an_order_book.get_mark_version(),
+            an_order_book.get_version());
+    ASSERT_FALSE(an_order_book.is_changed_up_to(test_ns::side_t::buy, 0));
+    an_order_book.add_order(3, test_ns::side_t::sell, 5, 110);
+    an_order_book.modify_order(2, 5, 95);
+    ASSERT_EQ(an_order_book.get_changes(test_ns::side_t::buy).best_price,
+            95);
+    ASSERT_TRUE(an_order_book.is_changed_up_to(test_ns::side_t::sell, 110));
+    ASSERT_FALSE(an_order_book.is_changed_up_to(test_ns::side_t::sell, 109));
+    ASSERT_NE(an_order_book.get_mark_version(),
+            an_order_book.get_version());
+}
+
 TEST(OrderBook, AddOrder1) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
         {
             auto order_1 = an_order_book.get_order(1);
             ASSERT_FALSE(order_1.first);
-            an_order_book.add_order(1, test_ns::side_t::buy, 20, 3.33);
+            an_order_book.add_order(1, test_ns::side_t::buy, 20,
+                    to_price(3.33));
             order_1 = an_order_book.get_order(1);
             ASSERT_TRUE(order_1.first);
             ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
             ASSERT_EQ(order_1.second.quantity, 20);
-            ASSERT_EQ(order_1.second.price, 3.33);
+            ASSERT_EQ(order_1.second.price, to_price(3.33));
         }
 
         {
             auto order_2 = an_order_book.get_order(2);
             ASSERT_FALSE(order_2.first);
-            an_order_book.add_order(2, test_ns::side_t::sell, 30, 4.33);
+            an_order_book.add_order(2, test_ns::side_t::sell, 30,
+                    to_price(4.33));
             order_2 = an_order_book.get_order(2);
             ASSERT_TRUE(order_2.first);
             ASSERT_EQ(order_2.second.side, test_ns::side_t::sell);
             ASSERT_EQ(order_2.second.quantity, 30);
-            ASSERT_EQ(order_2.second.price, 4.33);
+            ASSERT_EQ(order_2.second.price, to_price(4.33));
 
             auto order_1 = an_order_book.get_order(1);
             ASSERT_TRUE(order_1.first);
             ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
             ASSERT_EQ(order_1.second.quantity, 20);
-            ASSERT_EQ(order_1.second.price, 3.33);
+            ASSERT_EQ(order_1.second.price, to_price(3.33));
         }
     } catch (std::exception& e) {
         FAIL() << e.what();
@@ -1174,20 +1533,39 @@ TEST(OrderBook, AddDuplicatiteOrder) {
         test_ns::order_book an_order_book{test_symbol_1};
         auto order_1 = an_order_book.get_order(1);
         ASSERT_FALSE(order_1.first);
-        an_order_book.add_order(1, test_ns::side_t::buy, 20, 3.33);
+        an_order_book.add_order(1, test_ns::side_t::buy, 20, to_price(3.33));
         order_1 = an_order_book.get_order(1);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 3.33);
+        ASSERT_EQ(order_1.second.price, to_price(3.33));
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 30, 4.33);
-        FAIL() << "duplicate orders must result in exception";
+        ASSERT_EQ(an_order_book.add_order(1, test_ns::side_t::sell, 30,
+                to_price(4.33)), test_ns::book_status_t::duplicate_id);
+        order_1 = an_order_book.get_order(1);
+        ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
+        ASSERT_EQ(order_1.second.quantity, 20);
     } catch (std::exception& e) {
-        SUCCEED();
+        FAIL() << e.what();
     }
 }
 
+TEST(OrderBook, UnknownOrder) {
+    test_ns::order_book an_order_book{test_symbol_1};
+    ASSERT_EQ(an_order_book.add_order(1, test_ns::side_t::buy, 20, 100),
+            test_ns::book_status_t::ok);
+    ASSERT_EQ(an_order_book.modify_order(2, 30, 100),
+            test_ns::book_status_t::unknown_id);
+    ASSERT_EQ(an_order_book.cancel_order(2),
+            test_ns::book_status_t::unknown_id);
+    ASSERT_EQ(an_order_book.modify_order(1, 30, 100),
+            test_ns::book_status_t::ok);
+    ASSERT_EQ(an_order_book.cancel_order(1), test_ns::book_status_t::ok);
+    ASSERT_EQ(an_order_book.cancel_order(1),
+            test_ns::book_status_t::unknown_id);
+    ASSERT_FALSE(an_order_book.get_order(1).first);
+}
+
 TEST(OrderBook, GetPriceLevel) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
@@ -1201,7 +1579,7 @@ TEST(OrderBook, GetPriceLevel) {
         ASSERT_EQ(get_price_levels.bids.size(), 0);
         ASSERT_EQ(get_price_levels.sales.size(), 0);
 
-        an_order_book.add_order(1, test_ns::side_t::buy, 20, 3.33);
+        an_order_book.add_order(1, test_ns::side_t::buy, 20, to_price(3.33));
         test_ns::get_price_levels_callback_t callback2 =
                 std::bind(&get_price_levels_t::func, &get_price_levels,
                         std::placeholders::_1, std::placeholders::_2);
@@ -1210,7 +1588,7 @@ TEST(OrderBook, GetPriceLevel) {
         ASSERT_EQ(get_price_levels.bids.size(), 1);
         ASSERT_EQ(get_price_levels.sales.size(), 1);
         ASSERT_TRUE(get_price_levels.bids[0].first);
-        ASSERT_EQ(get_price_levels.bids[0].second.price, 3.33);
+        ASSERT_EQ(get_price_levels.bids[0].second.price, to_price(3.33));
         ASSERT_EQ(get_price_levels.bids[0].second.volume, 20);
         ASSERT_FALSE(get_price_levels.sales[0].first);
     } catch (std::exception& e) {
@@ -1222,10 +1600,10 @@ TEST(OrderBook, GetPriceLevelSale) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 20, 10.);
-        an_order_book.add_order(2, test_ns::side_t::sell, 40, 12.);
-        an_order_book.add_order(3, test_ns::side_t::sell, 5, 10.);
-        an_order_book.add_order(4, test_ns::side_t::sell, 10, 12.);
+        an_order_book.add_order(1, test_ns::side_t::sell, 20, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::sell, 40, to_price(12.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 5, to_price(10.));
+        an_order_book.add_order(4, test_ns::side_t::sell, 10, to_price(12.));
 
         get_price_levels_t get_price_levels;
         test_ns::get_price_levels_callback_t callback2 =
@@ -1239,10 +1617,10 @@ TEST(OrderBook, GetPriceLevelSale) {
 
         ASSERT_EQ(get_price_levels.sales.size(), 2);
         ASSERT_TRUE(get_price_levels.sales[0].first);
-        ASSERT_EQ(get_price_levels.sales[0].second.price, 10.);
+        ASSERT_EQ(get_price_levels.sales[0].second.price, to_price(10.));
         ASSERT_EQ(get_price_levels.sales[0].second.volume, 25);
         ASSERT_TRUE(get_price_levels.sales[1].first);
-        ASSERT_EQ(get_price_levels.sales[1].second.price, 12.);
+        ASSERT_EQ(get_price_levels.sales[1].second.price, to_price(12.));
         ASSERT_EQ(get_price_levels.sales[1].second.volume, 50);
     } catch (std::exception& e) {
         FAIL() << e.what();
@@ -1253,14 +1631,14 @@ TEST(OrderBook, GetPriceLevelBye) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 20, 10.);
-        an_order_book.add_order(2, test_ns::side_t::sell, 40, 12.);
-        an_order_book.add_order(3, test_ns::side_t::sell, 5, 10.);
-        an_order_book.add_order(4, test_ns::side_t::sell, 10, 12.);
-        an_order_book.add_order(5, test_ns::side_t::buy, 20, 10.);
-        an_order_book.add_order(6, test_ns::side_t::buy, 40, 12.);
-        an_order_book.add_order(7, test_ns::side_t::buy, 5, 10.);
-        an_order_book.add_order(8, test_ns::side_t::buy, 10, 12.);
+        an_order_book.add_order(1, test_ns::side_t::sell, 20, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::sell, 40, to_price(12.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 5, to_price(10.));
+        an_order_book.add_order(4, test_ns::side_t::sell, 10, to_price(12.));
+        an_order_book.add_order(5, test_ns::side_t::buy, 20, to_price(10.));
+        an_order_book.add_order(6, test_ns::side_t::buy, 40, to_price(12.));
+        an_order_book.add_order(7, test_ns::side_t::buy, 5, to_price(10.));
+        an_order_book.add_order(8, test_ns::side_t::buy, 10, to_price(12.));
 
         get_price_levels_t get_price_levels;
         test_ns::get_price_levels_callback_t callback2 =
@@ -1270,18 +1648,18 @@ TEST(OrderBook, GetPriceLevelBye) {
 
         ASSERT_EQ(get_price_levels.sales.size(), 2);
         ASSERT_TRUE(get_price_levels.sales[0].first);
-        ASSERT_EQ(get_price_levels.sales[0].second.price, 10.);
+        ASSERT_EQ(get_price_levels.sales[0].second.price, to_price(10.));
         ASSERT_EQ(get_price_levels.sales[0].second.volume, 25);
         ASSERT_TRUE(get_price_levels.sales[1].first);
-        ASSERT_EQ(get_price_levels.sales[1].second.price, 12.);
+        ASSERT_EQ(get_price_levels.sales[1].second.price, to_price(12.));
         ASSERT_EQ(get_price_levels.sales[1].second.volume, 50);
 
         ASSERT_EQ(get_price_levels.bids.size(), 2);
         ASSERT_TRUE(get_price_levels.bids[0].first);
-        ASSERT_EQ(get_price_levels.bids[0].second.price, 12.);
+        ASSERT_EQ(get_price_levels.bids[0].second.price, to_price(12.));
         ASSERT_EQ(get_price_levels.bids[0].second.volume, 50);
         ASSERT_TRUE(get_price_levels.bids[1].first);
-        ASSERT_EQ(get_price_levels.bids[1].second.price, 10.);
+        ASSERT_EQ(get_price_levels.bids[1].second.price, to_price(10.));
         ASSERT_EQ(get_price_levels.bids[1].second.volume, 25);
     } catch (std::exception& e) {
         FAIL() << e.what();
@@ -1292,10 +1670,10 @@ TEST(OrderBook, GetPriceLevelAll) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
 
-        an_order_book.add_order(1, test_ns::side_t::buy, 20, 10.);
-        an_order_book.add_order(2, test_ns::side_t::buy, 40, 12.);
-        an_order_book.add_order(3, test_ns::side_t::buy, 5, 10.);
-        an_order_book.add_order(4, test_ns::side_t::buy, 10, 12.);
+        an_order_book.add_order(1, test_ns::side_t::buy, 20, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::buy, 40, to_price(12.));
+        an_order_book.add_order(3, test_ns::side_t::buy, 5, to_price(10.));
+        an_order_book.add_order(4, test_ns::side_t::buy, 10, to_price(12.));
 
         get_price_levels_t get_price_levels;
         test_ns::get_price_levels_callback_t callback2 =
@@ -1309,10 +1687,10 @@ TEST(OrderBook, GetPriceLevelAll) {
 
         ASSERT_EQ(get_price_levels.bids.size(), 2);
         ASSERT_TRUE(get_price_levels.bids[0].first);
-        ASSERT_EQ(get_price_levels.bids[0].second.price, 12.);
+        ASSERT_EQ(get_price_levels.bids[0].second.price, to_price(12.));
         ASSERT_EQ(get_price_levels.bids[0].second.volume, 50);
         ASSERT_TRUE(get_price_levels.bids[1].first);
-        ASSERT_EQ(get_price_levels.bids[1].second.price, 10.);
+        ASSERT_EQ(get_price_levels.bids[1].second.price, to_price(10.));
         ASSERT_EQ(get_price_levels.bids[1].second.volume, 25);
     } catch (std::exception& e) {
         FAIL() << e.what();
@@ -1323,25 +1701,25 @@ TEST(OrderBook, BBO) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 20, 10.);
-        an_order_book.add_order(2, test_ns::side_t::sell, 40, 12.);
-        an_order_book.add_order(3, test_ns::side_t::sell, 5, 10.);
-        an_order_book.add_order(4, test_ns::side_t::sell, 10, 12.);
-        an_order_book.add_order(5, test_ns::side_t::buy, 20, 10.);
-        an_order_book.add_order(6, test_ns::side_t::buy, 40, 12.);
-        an_order_book.add_order(7, test_ns::side_t::buy, 5, 10.);
-        an_order_book.add_order(8, test_ns::side_t::buy, 10, 12.);
+        an_order_book.add_order(1, test_ns::side_t::sell, 20, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::sell, 40, to_price(12.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 5, to_price(10.));
+        an_order_book.add_order(4, test_ns::side_t::sell, 10, to_price(12.));
+        an_order_book.add_order(5, test_ns::side_t::buy, 20, to_price(10.));
+        an_order_book.add_order(6, test_ns::side_t::buy, 40, to_price(12.));
+        an_order_book.add_order(7, test_ns::side_t::buy, 5, to_price(10.));
+        an_order_book.add_order(8, test_ns::side_t::buy, 10, to_price(12.));
 
         test_ns::bbo_t bbo;
         an_order_book.get_bbo(&bbo);
 
         ASSERT_EQ(bbo.buy.first, true);
         ASSERT_EQ(bbo.buy.second.volume, 50);
-        ASSERT_EQ(bbo.buy.second.price, 12);
+        ASSERT_EQ(bbo.buy.second.price, to_price(12));
 
         ASSERT_EQ(bbo.sell.first, true);
         ASSERT_EQ(bbo.sell.second.volume, 25);
-        ASSERT_EQ(bbo.sell.second.price, 10);
+        ASSERT_EQ(bbo.sell.second.price, to_price(10));
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -1351,17 +1729,17 @@ TEST(OrderBook, BBOBuyOnly) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
 
-        an_order_book.add_order(5, test_ns::side_t::buy, 20, 10.);
-        an_order_book.add_order(6, test_ns::side_t::buy, 40, 12.);
-        an_order_book.add_order(7, test_ns::side_t::buy, 5, 10.);
-        an_order_book.add_order(8, test_ns::side_t::buy, 10, 12.);
+        an_order_book.add_order(5, test_ns::side_t::buy, 20, to_price(10.));
+        an_order_book.add_order(6, test_ns::side_t::buy, 40, to_price(12.));
+        an_order_book.add_order(7, test_ns::side_t::buy, 5, to_price(10.));
+        an_order_book.add_order(8, test_ns::side_t::buy, 10, to_price(12.));
 
         test_ns::bbo_t bbo;
         an_order_book.get_bbo(&bbo);
 
         ASSERT_EQ(bbo.buy.first, true);
         ASSERT_EQ(bbo.buy.second.volume, 50);
-        ASSERT_EQ(bbo.buy.second.price, 12);
+        ASSERT_EQ(bbo.buy.second.price, to_price(12));
 
         ASSERT_EQ(bbo.sell.first, false);
     } catch (std::exception& e) {
@@ -1373,10 +1751,10 @@ TEST(OrderBook, BBOSellOnly) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 20, 10.);
-        an_order_book.add_order(2, test_ns::side_t::sell, 40, 12.);
-        an_order_book.add_order(3, test_ns::side_t::sell, 5, 10.);
-        an_order_book.add_order(4, test_ns::side_t::sell, 10, 12.);
+        an_order_book.add_order(1, test_ns::side_t::sell, 20, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::sell, 40, to_price(12.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 5, to_price(10.));
+        an_order_book.add_order(4, test_ns::side_t::sell, 10, to_price(12.));
 
         test_ns::bbo_t bbo;
         an_order_book.get_bbo(&bbo);
@@ -1385,7 +1763,42 @@ TEST(OrderBook, BBOSellOnly) {
 
         ASSERT_EQ(bbo.sell.first, true);
         ASSERT_EQ(bbo.sell.second.volume, 25);
-        ASSERT_EQ(bbo.sell.second.price, 10);
+        ASSERT_EQ(bbo.sell.second.price, to_price(10));
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+TEST(OrderBook, BBOLevelVolume) {
+    try {
+        test_ns::order_book an_order_book{test_symbol_1};
+
+        an_order_book.add_order(1, test_ns::side_t::buy, 20, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::buy, 30, to_price(10.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 40, to_price(11.));
+
+        test_ns::bbo_t bbo;
+        an_order_book.get_bbo(&bbo);
+        ASSERT_EQ(bbo.buy.second.volume, 50);
+
+        an_order_book.modify_order(1, 5, to_price(10.));
+        an_order_book.get_bbo(&bbo);
+        ASSERT_EQ(bbo.buy.second.volume, 35);
+
+        an_order_book.modify_order(2, 30, to_price(9.));
+        an_order_book.get_bbo(&bbo);
+        ASSERT_EQ(bbo.buy.second.volume, 5);
+        ASSERT_EQ(bbo.buy.second.price, to_price(10.));
+
+        an_order_book.cancel_order(1);
+        an_order_book.get_bbo(&bbo);
+        ASSERT_EQ(bbo.buy.first, true);
+        ASSERT_EQ(bbo.buy.second.volume, 30);
+        ASSERT_EQ(bbo.buy.second.price, to_price(9.));
+
+        an_order_book.cancel_order(3);
+        an_order_book.get_bbo(&bbo);
+        ASSERT_EQ(bbo.sell.first, false);
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -1397,26 +1810,26 @@ TEST(OrderBook, ModifyOrder1) {
 
         auto order_1 = an_order_book.get_order(1);
         ASSERT_FALSE(order_1.first);
-        an_order_book.add_order(111, test_ns::side_t::buy, 20, 10.0);
+        an_order_book.add_order(111, test_ns::side_t::buy, 20, to_price(10.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 10.);
+        ASSERT_EQ(order_1.second.price, to_price(10.));
 
-        an_order_book.modify_order(111, 30, 40.0);
+        an_order_book.modify_order(111, 30, to_price(40.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 30);
-        ASSERT_EQ(order_1.second.price, 40.);
+        ASSERT_EQ(order_1.second.price, to_price(40.));
 
-        an_order_book.modify_order(111, 50, 70.0);
+        an_order_book.modify_order(111, 50, to_price(70.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 50);
-        ASSERT_EQ(order_1.second.price, 70.);
+        ASSERT_EQ(order_1.second.price, to_price(70.));
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -1428,26 +1841,26 @@ TEST(OrderBook, ModifyOrder2) {
 
         auto order_1 = an_order_book.get_order(1);
         ASSERT_FALSE(order_1.first);
-        an_order_book.add_order(111, test_ns::side_t::sell, 20, 10.0);
+        an_order_book.add_order(111, test_ns::side_t::sell, 20, to_price(10.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::sell);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 10.);
+        ASSERT_EQ(order_1.second.price, to_price(10.));
 
-        an_order_book.modify_order(111, 30, 40.0);
+        an_order_book.modify_order(111, 30, to_price(40.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::sell);
         ASSERT_EQ(order_1.second.quantity, 30);
-        ASSERT_EQ(order_1.second.price, 40.);
+        ASSERT_EQ(order_1.second.price, to_price(40.));
 
-        an_order_book.modify_order(111, 50, 70.0);
+        an_order_book.modify_order(111, 50, to_price(70.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::sell);
         ASSERT_EQ(order_1.second.quantity, 50);
-        ASSERT_EQ(order_1.second.price, 70.);
+        ASSERT_EQ(order_1.second.price, to_price(70.));
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -1459,12 +1872,12 @@ TEST(OrderBook, CancelOrderBuy) {
 
         auto order_1 = an_order_book.get_order(1);
         ASSERT_FALSE(order_1.first);
-        an_order_book.add_order(111, test_ns::side_t::buy, 20, 10.0);
+        an_order_book.add_order(111, test_ns::side_t::buy, 20, to_price(10.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 10.);
+        ASSERT_EQ(order_1.second.price, to_price(10.));
 
         an_order_book.cancel_order(111);
         order_1 = an_order_book.get_order(111);
@@ -1480,12 +1893,12 @@ TEST(OrderBook, CancelOrderSell) {
 
         auto order_1 = an_order_book.get_order(1);
         ASSERT_FALSE(order_1.first);
-        an_order_book.add_order(111, test_ns::side_t::buy, 20, 10.0);
+        an_order_book.add_order(111, test_ns::side_t::buy, 20, to_price(10.0));
         order_1 = an_order_book.get_order(111);
         ASSERT_TRUE(order_1.first);
         ASSERT_EQ(order_1.second.side, test_ns::side_t::buy);
         ASSERT_EQ(order_1.second.quantity, 20);
-        ASSERT_EQ(order_1.second.price, 10.);
+        ASSERT_EQ(order_1.second.price, to_price(10.));
 
         an_order_book.cancel_order(111);
         order_1 = an_order_book.get_order(111);
@@ -1504,17 +1917,17 @@ TEST(OrderBook, VWAPBuyOnly) {
         ASSERT_EQ(vwap.buy.valid, false);
         ASSERT_EQ(vwap.sell.valid, false);
 
-        an_order_book.add_order(5, test_ns::side_t::buy, 10, 72.82);
-        an_order_book.add_order(6, test_ns::side_t::buy, 100, 72.81);
+        an_order_book.add_order(5, test_ns::side_t::buy, 10, to_price(72.82));
+        an_order_book.add_order(6, test_ns::side_t::buy, 100, to_price(72.81));
 
         an_order_book.get_vwap(5, &vwap);
         ASSERT_EQ(vwap.buy.valid, true);
-        ASSERT_EQ(vwap.buy.price, 72.82);
+        ASSERT_EQ(vwap_price(vwap, vwap.buy), 72.82);
         ASSERT_EQ(vwap.sell.valid, false);
 
         an_order_book.get_vwap(20, &vwap);
         ASSERT_EQ(vwap.buy.valid, true);
-        ASSERT_EQ(vwap.buy.price, 72.815);
+        ASSERT_EQ(vwap_price(vwap, vwap.buy), 72.815);
         ASSERT_EQ(vwap.sell.valid, false);
     } catch (std::exception& e) {
         FAIL() << e.what();
@@ -1530,18 +1943,18 @@ TEST(OrderBook, VWAPSellOnly) {
         ASSERT_EQ(vwap.buy.valid, false);
         ASSERT_EQ(vwap.sell.valid, false);
 
-        an_order_book.add_order(6, test_ns::side_t::sell, 10, 100.);
-        an_order_book.add_order(5, test_ns::side_t::sell, 20, 200.);
+        an_order_book.add_order(6, test_ns::side_t::sell, 10, to_price(100.));
+        an_order_book.add_order(5, test_ns::side_t::sell, 20, to_price(200.));
 
         an_order_book.get_vwap(5, &vwap);
         ASSERT_EQ(vwap.buy.valid, false);
         ASSERT_EQ(vwap.sell.valid, true);
-        ASSERT_EQ(vwap.sell.price, 100.);
+        ASSERT_EQ(vwap_price(vwap, vwap.sell), 100.);
 
         an_order_book.get_vwap(20, &vwap);
         ASSERT_EQ(vwap.buy.valid, false);
         ASSERT_EQ(vwap.sell.valid, true);
-        ASSERT_EQ(vwap.sell.price, 150.);
+        ASSERT_EQ(vwap_price(vwap, vwap.sell), 150.);
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
@@ -1556,27 +1969,86 @@ TEST(OrderBook, VWAPBuyAndSell) {
         ASSERT_EQ(vwap.buy.valid, false);
         ASSERT_EQ(vwap.sell.valid, false);
 
-        an_order_book.add_order(1, test_ns::side_t::buy, 10, 72.82);
-        an_order_book.add_order(2, test_ns::side_t::buy, 100, 72.81);
-        an_order_book.add_order(3, test_ns::side_t::sell, 10, 100.);
-        an_order_book.add_order(4, test_ns::side_t::sell, 20, 200.);
+        an_order_book.add_order(1, test_ns::side_t::buy, 10, to_price(72.82));
+        an_order_book.add_order(2, test_ns::side_t::buy, 100, to_price(72.81));
+        an_order_book.add_order(3, test_ns::side_t::sell, 10, to_price(100.));
+        an_order_book.add_order(4, test_ns::side_t::sell, 20, to_price(200.));
 
         an_order_book.get_vwap(5, &vwap);
         ASSERT_EQ(vwap.buy.valid, true);
-        ASSERT_EQ(vwap.buy.price, 72.82);
+        ASSERT_EQ(vwap_price(vwap, vwap.buy), 72.82);
         ASSERT_EQ(vwap.sell.valid, true);
-        ASSERT_EQ(vwap.sell.price, 100.);
+        ASSERT_EQ(vwap_price(vwap, vwap.sell), 100.);
 
         an_order_book.get_vwap(20, &vwap);
         ASSERT_EQ(vwap.buy.valid, true);
-        ASSERT_EQ(vwap.buy.price, 72.815);
+        ASSERT_EQ(vwap_price(vwap, vwap.buy), 72.815);
         ASSERT_EQ(vwap.sell.valid, true);
-        ASSERT_EQ(vwap.sell.price, 150.);
+        ASSERT_EQ(vwap_price(vwap, vwap.sell), 150.);
     } catch (std::exception& e) {
         FAIL() << e.what();
     }
 }
 
+TEST(OrderBook, VWAPNotEnoughVolume) {
+    try {
+        test_ns::order_book an_order_book{test_symbol_1};
+
+        test_ns::vwap_t vwap;
+        an_order_book.add_order(1, test_ns::side_t::buy, 10, to_price(72.82));
+        an_order_book.add_order(2, test_ns::side_t::sell, 10, to_price(100.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 20, to_price(100.));
+
+        an_order_book.get_vwap(30, &vwap);
+        ASSERT_EQ(vwap.buy.valid, false);
+        ASSERT_EQ(vwap.sell.valid, true);
+        ASSERT_EQ(vwap_price(vwap, vwap.sell), 100.);
+
+        an_order_book.get_vwap(31, &vwap);
+        ASSERT_EQ(vwap.buy.valid, false);
+        ASSERT_EQ(vwap.sell.valid, false);
+    } catch (std::exception& e) {
+        FAIL() << e.what();
+    }
+}
+
+/*
+ * The batch gives the same result as one walk per quantity, including
+ * equal quantities and quantities beyond the depth of a side.
+ */
+TEST(OrderBook, VWAPBatch) {
+    test_ns::order_book an_order_book{test_symbol_1};
+    test_ns::order_id_t id = 0;
+    for (int level = 0; level < 10; ++level) {
+        an_order_book.add_order(++id, test_ns::side_t::buy, 5 + level,
+                to_price(50 - level));
+        an_order_book.add_order(++id, test_ns::side_t::buy, 1,
+                to_price(50 - level));
+        an_order_book.add_order(++id, test_ns::side_t::sell, 2 * level + 1,
+                to_price(51 + level * 0.5));
+    }
+    std::vector<test_ns::quantity_t> quantities = {1, 5, 6, 7, 25, 25, 60,
+            100, 105, 106, 1000};
+    std::vector<test_ns::vwap_t> vwaps(quantities.size());
+    an_order_book.get_vwaps(quantities.data(), quantities.size(),
+            vwaps.data());
+    for (size_t i = 0; i < quantities.size(); ++i) {
+        test_ns::vwap_t vwap;
+        an_order_book.get_vwap(quantities[i], &vwap);
+        ASSERT_EQ(vwaps[i].quantity, quantities[i]);
+        ASSERT_EQ(vwaps[i].buy.valid, vwap.buy.valid) << quantities[i];
+        ASSERT_EQ(vwaps[i].sell.valid, vwap.sell.valid) << quantities[i];
+        ASSERT_TRUE(vwaps[i].buy.notional == vwap.buy.notional);
+        ASSERT_TRUE(vwaps[i].sell.notional == vwap.sell.notional);
+    }
+    // 6 from 50 and 1 from 49
+    ASSERT_TRUE(vwaps[3].buy.notional == 6 * to_price(50) + to_price(49));
+    ASSERT_TRUE(vwaps[8].buy.valid);
+    ASSERT_FALSE(vwaps[9].buy.valid);
+    ASSERT_TRUE(vwaps[7].sell.valid);
+    ASSERT_FALSE(vwaps[8].sell.valid);
+}
+
 TEST(OrderBook, PrintFullEmpty) {
     try {
         test_ns::order_book an_order_book{test_symbol_1};
@@ -1598,7 +2070,7 @@ TEST(OrderBook, PrintFullBuy1) {
                         &get_full_orders,
                         std::placeholders::_1, std::placeholders::_2);
 
-        an_order_book.add_order(1, test_ns::side_t::buy, 100, 10.);
+        an_order_book.add_order(1, test_ns::side_t::buy, 100, to_price(10.));
 
         an_order_book.get_full_orders(std::move(callback));
         ASSERT_EQ(get_full_orders.bids.size(), 1);
@@ -1606,7 +2078,7 @@ TEST(OrderBook, PrintFullBuy1) {
 
         ASSERT_EQ(get_full_orders.bids[0].valid, true);
         ASSERT_EQ(get_full_orders.bids[0].orders, 1);
-        ASSERT_EQ(get_full_orders.bids[0].price, 10.);
+        ASSERT_EQ(get_full_orders.bids[0].price, to_price(10.));
         ASSERT_EQ(get_full_orders.bids[0].volume, 100);
         ASSERT_EQ(get_full_orders.asks[0].valid, false);
     } catch (std::exception& e) {
@@ -1623,9 +2095,9 @@ TEST(OrderBook, PrintFullBuy2) {
                         &get_full_orders,
                         std::placeholders::_1, std::placeholders::_2);
 
-        an_order_book.add_order(1, test_ns::side_t::buy, 100, 10.);
-        an_order_book.add_order(2, test_ns::side_t::buy, 200, 9.);
-        an_order_book.add_order(3, test_ns::side_t::buy, 300, 10.);
+        an_order_book.add_order(1, test_ns::side_t::buy, 100, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::buy, 200, to_price(9.));
+        an_order_book.add_order(3, test_ns::side_t::buy, 300, to_price(10.));
 
         an_order_book.get_full_orders(std::move(callback));
         ASSERT_EQ(get_full_orders.bids.size(), 2);
@@ -1633,11 +2105,11 @@ TEST(OrderBook, PrintFullBuy2) {
 
         ASSERT_EQ(get_full_orders.bids[0].valid, true);
         ASSERT_EQ(get_full_orders.bids[0].orders, 2);
-        ASSERT_EQ(get_full_orders.bids[0].price, 10.);
+        ASSERT_EQ(get_full_orders.bids[0].price, to_price(10.));
         ASSERT_EQ(get_full_orders.bids[0].volume, 400);
         ASSERT_EQ(get_full_orders.bids[1].valid, true);
         ASSERT_EQ(get_full_orders.bids[1].orders, 1);
-        ASSERT_EQ(get_full_orders.bids[1].price, 9.);
+        ASSERT_EQ(get_full_orders.bids[1].price, to_price(9.));
         ASSERT_EQ(get_full_orders.bids[1].volume, 200);
         ASSERT_EQ(get_full_orders.asks[0].valid, false);
         ASSERT_EQ(get_full_orders.asks[1].valid, false);
@@ -1655,7 +2127,7 @@ TEST(OrderBook, PrintFullSell1) {
                         &get_full_orders,
                         std::placeholders::_1, std::placeholders::_2);
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 100, 10.);
+        an_order_book.add_order(1, test_ns::side_t::sell, 100, to_price(10.));
 
         an_order_book.get_full_orders(std::move(callback));
         ASSERT_EQ(get_full_orders.bids.size(), 1);
@@ -1663,7 +2135,7 @@ TEST(OrderBook, PrintFullSell1) {
 
         ASSERT_EQ(get_full_orders.asks[0].valid, true);
         ASSERT_EQ(get_full_orders.asks[0].orders, 1);
-        ASSERT_EQ(get_full_orders.asks[0].price, 10.);
+        ASSERT_EQ(get_full_orders.asks[0].price, to_price(10.));
         ASSERT_EQ(get_full_orders.asks[0].volume, 100);
         ASSERT_EQ(get_full_orders.bids[0].valid, false);
     } catch (std::exception& e) {
@@ -1680,12 +2152,12 @@ TEST(OrderBook, PrintFullSell2) {
                         &get_full_orders,
                         std::placeholders::_1, std::placeholders::_2);
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 100, 10.);
-        an_order_book.add_order(2, test_ns::side_t::sell, 200, 11.);
-        an_order_book.add_order(3, test_ns::side_t::sell, 300, 10.);
-        an_order_book.add_order(4, test_ns::side_t::buy, 100, 10.);
-        an_order_book.add_order(5, test_ns::side_t::buy, 200, 9.);
-        an_order_book.add_order(6, test_ns::side_t::buy, 300, 10.);
+        an_order_book.add_order(1, test_ns::side_t::sell, 100, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::sell, 200, to_price(11.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 300, to_price(10.));
+        an_order_book.add_order(4, test_ns::side_t::buy, 100, to_price(10.));
+        an_order_book.add_order(5, test_ns::side_t::buy, 200, to_price(9.));
+        an_order_book.add_order(6, test_ns::side_t::buy, 300, to_price(10.));
 
         an_order_book.get_full_orders(std::move(callback));
         ASSERT_EQ(get_full_orders.bids.size(), 2);
@@ -1693,19 +2165,19 @@ TEST(OrderBook, PrintFullSell2) {
 
         ASSERT_EQ(get_full_orders.asks[0].valid, true);
         ASSERT_EQ(get_full_orders.asks[0].orders, 2);
-        ASSERT_EQ(get_full_orders.asks[0].price, 10.);
+        ASSERT_EQ(get_full_orders.asks[0].price, to_price(10.));
         ASSERT_EQ(get_full_orders.asks[0].volume, 400);
         ASSERT_EQ(get_full_orders.asks[1].valid, true);
         ASSERT_EQ(get_full_orders.asks[1].orders, 1);
-        ASSERT_EQ(get_full_orders.asks[1].price, 11.);
+        ASSERT_EQ(get_full_orders.asks[1].price, to_price(11.));
         ASSERT_EQ(get_full_orders.asks[1].volume, 200);
         ASSERT_EQ(get_full_orders.bids[0].valid, true);
         ASSERT_EQ(get_full_orders.bids[0].orders, 2);
-        ASSERT_EQ(get_full_orders.bids[0].price, 10.);
+        ASSERT_EQ(get_full_orders.bids[0].price, to_price(10.));
         ASSERT_EQ(get_full_orders.bids[0].volume, 400);
         ASSERT_EQ(get_full_orders.bids[1].valid, true);
         ASSERT_EQ(get_full_orders.bids[1].orders, 1);
-        ASSERT_EQ(get_full_orders.bids[1].price, 9.);
+        ASSERT_EQ(get_full_orders.bids[1].price, to_price(9.));
         ASSERT_EQ(get_full_orders.bids[1].volume, 200);
     } catch (std::exception& e) {
         FAIL() << e.what();
@@ -1721,9 +2193,9 @@ TEST(OrderBook, PrintFullBidsSells) {
                         &get_full_orders,
                         std::placeholders::_1, std::placeholders::_2);
 
-        an_order_book.add_order(1, test_ns::side_t::sell, 100, 10.);
-        an_order_book.add_order(2, test_ns::side_t::sell, 200, 11.);
-        an_order_book.add_order(3, test_ns::side_t::sell, 300, 10.);
+        an_order_book.add_order(1, test_ns::side_t::sell, 100, to_price(10.));
+        an_order_book.add_order(2, test_ns::side_t::sell, 200, to_price(11.));
+        an_order_book.add_order(3, test_ns::side_t::sell, 300, to_price(10.));
 
         an_order_book.get_full_orders(std::move(callback));
         ASSERT_EQ(get_full_orders.bids.size(), 2);
@@ -1731,11 +2203,11 @@ TEST(OrderBook, PrintFullBidsSells) {
 
         ASSERT_EQ(get_full_orders.asks[0].valid, true);
         ASSERT_EQ(get_full_orders.asks[0].orders, 2);
-        ASSERT_EQ(get_full_orders.asks[0].price, 10.);
+        ASSERT_EQ(get_full_orders.asks[0].price, to_price(10.));
         ASSERT_EQ(get_full_orders.asks[0].volume, 400);
         ASSERT_EQ(get_full_orders.asks[1].valid, true);
         ASSERT_EQ(get_full_orders.asks[1].orders, 1);
-        ASSERT_EQ(get_full_orders.asks[1].price, 11.);
+        ASSERT_EQ(get_full_orders.asks[1].price, to_price(11.));
         ASSERT_EQ(get_full_orders.asks[1].volume, 200);
         ASSERT_EQ(get_full_orders.bids[0].valid, false);
         ASSERT_EQ(get_full_orders.bids[1].valid, false);
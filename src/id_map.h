@@ -0,0 +1,182 @@
+#ifndef ID_MAP_H
+#define ID_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace test_ns {
+
+/*
+ * Hash map from 64-bit ids to values in one flat array, with linear
+ * probing. A lookup reads consecutive slots instead of chasing a node
+ * pointer per entry. Erasing shifts the following entries of the probe
+ * run back, so there are no tombstones and probe runs never grow with
+ * churn. The array doubles when it is 3/4 full.
+ *
+ * Pointers returned by find() and operator[] are invalidated by any
+ * insertion or erase.
+ */
+template <typename value_t>
+class id_map {
+ public:
+    id_map() : count(0), mask(0) {}
+
+    value_t* find(uint64_t key) {
+        if (count == 0) {
+            return nullptr;
+        }
+        for (size_t i = home(key); slots[i].used; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                return &slots[i].value;
+            }
+        }
+        return nullptr;
+    }
+
+    const value_t* find(uint64_t key) const {
+        return const_cast<id_map*>(this)->find(key);
+    }
+
+    /*
+     * Inserts key with value unless key is already there. Returns the
+     * value of key and whether it was inserted, in one probe.
+     */
+    std::pair<value_t*, bool> insert(uint64_t key, const value_t& value) {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+        size_t i = home(key);
+        for (; slots[i].used; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                return std::make_pair(&slots[i].value, false);
+            }
+        }
+        slots[i].used = true;
+        slots[i].key = key;
+        slots[i].value = value;
+        ++count;
+        return std::make_pair(&slots[i].value, true);
+    }
+
+    /*
+     * The value of key, a default constructed one is inserted if there
+     * is none.
+     */
+    value_t& operator[](uint64_t key) {
+        return *insert(key, value_t()).first;
+    }
+
+    bool erase(uint64_t key) {
+        if (count == 0) {
+            return false;
+        }
+        size_t i = home(key);
+        for (; slots[i].used; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                remove_slot(i);
+                --count;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Erases key and moves its value out, in one probe.
+     */
+    bool erase(uint64_t key, value_t* value) {
+        if (count == 0) {
+            return false;
+        }
+        size_t i = home(key);
+        for (; slots[i].used; i = (i + 1) & mask) {
+            if (slots[i].key == key) {
+                *value = std::move(slots[i].value);
+                remove_slot(i);
+                --count;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    size_t size() const {
+        return count;
+    }
+    bool empty() const {
+        return count == 0;
+    }
+    void reserve(size_t size) {
+        size_t capacity = slots.empty() ? 16 : slots.size();
+        while (size * 4 > capacity * 3) {
+            capacity *= 2;
+        }
+        if (capacity != slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+ private:
+    struct slot_t {
+        uint64_t key;
+        value_t value;
+        bool used;
+        slot_t() : key(0), value(), used(false) {}
+    };
+    std::vector<slot_t> slots;
+    size_t count;
+    size_t mask;
+
+    /*
+     * Fibonacci hashing, spreads sequential ids over the whole table.
+     */
+    size_t home(uint64_t key) const {
+        return static_cast<size_t>(
+                (key * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & mask;
+    }
+
+    void grow() {
+        rehash(slots.empty() ? 16 : slots.size() * 2);
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<slot_t> old_slots(capacity);
+        old_slots.swap(slots);
+        mask = capacity - 1;
+        for (auto & old_slot : old_slots) {
+            if (!old_slot.used) {
+                continue;
+            }
+            size_t i = home(old_slot.key);
+            while (slots[i].used) {
+                i = (i + 1) & mask;
+            }
+            slots[i].used = true;
+            slots[i].key = old_slot.key;
+            slots[i].value = std::move(old_slot.value);
+        }
+    }
+
+    /*
+     * Empties slot i and moves back every following entry of the run
+     * that may live at or before the hole.
+     */
+    void remove_slot(size_t i) {
+        for (size_t j = (i + 1) & mask; slots[j].used; j = (j + 1) & mask) {
+            size_t k = home(slots[j].key);
+            if (((j - k) & mask) >= ((j - i) & mask)) {
+                slots[i].key = slots[j].key;
+                slots[i].value = std::move(slots[j].value);
+                i = j;
+            }
+        }
+        slots[i].used = false;
+        slots[i].value = value_t();
+    }
+};
+
+}  // namespace test_ns
+
+#endif  // ID_MAP_H
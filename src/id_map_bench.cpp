@@ -0,0 +1,99 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "id_map.h"
+#include "node_pool.h"
+
+/*
+ * Compares id_map with the std::unordered_map it replaces as the index
+ * of live orders: lookups of live ids, and cancel/add churn that keeps
+ * the number of live orders constant.
+ */
+namespace {
+
+using node_index_t = test_ns::node_index_t;
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+struct std_index_t {
+    std::unordered_map<uint64_t, node_index_t> map;
+    void reserve(size_t size) { map.reserve(size); }
+    void insert(uint64_t id, node_index_t node) { map.emplace(id, node); }
+    node_index_t find(uint64_t id) const {
+        auto itr = map.find(id);
+        return itr == map.end() ? test_ns::null_node : itr->second;
+    }
+    void erase(uint64_t id) { map.erase(id); }
+};
+
+struct flat_index_t {
+    test_ns::id_map<node_index_t> map;
+    void reserve(size_t size) { map.reserve(size); }
+    void insert(uint64_t id, node_index_t node) { map.insert(id, node); }
+    node_index_t find(uint64_t id) const {
+        auto node = map.find(id);
+        return node == nullptr ? test_ns::null_node : *node;
+    }
+    void erase(uint64_t id) { map.erase(id); }
+};
+
+/*
+ * Ids are increasing with gaps, as exchange order ids usually are.
+ */
+template<typename index_t>
+void run(const char* name, size_t live_orders) {
+    const size_t operations = 5000000;
+    std::mt19937_64 generator(1);
+    std::vector<uint64_t> ids(live_orders);
+    uint64_t next_id = 1000;
+    for (auto & id : ids) {
+        id = next_id += 1 + generator() % 4;
+    }
+    std::vector<size_t> picks(operations);
+    for (auto & pick : picks) {
+        pick = generator() % live_orders;
+    }
+
+    index_t index;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < live_orders; ++i) {
+        index.insert(ids[i], static_cast<node_index_t>(i));
+    }
+    double insert_ns = elapsed_ns(start) / live_orders;
+
+    uint64_t sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (auto pick : picks) {
+        sum += index.find(ids[pick]);
+    }
+    double find_ns = elapsed_ns(start) / operations;
+
+    start = std::chrono::steady_clock::now();
+    for (auto pick : picks) {
+        sum += index.find(ids[pick]);
+        index.erase(ids[pick]);
+        ids[pick] = next_id += 1 + pick % 4;
+        index.insert(ids[pick], static_cast<node_index_t>(pick));
+    }
+    double churn_ns = elapsed_ns(start) / operations;
+
+    std::printf("%-14s %9zu live  insert %6.1f  find %6.1f  "
+            "cancel+add %6.1f ns  (checksum %llu)\n", name, live_orders,
+            insert_ns, find_ns, churn_ns,
+            static_cast<unsigned long long>(sum));
+}
+
+}  // namespace
+
+int main() {
+    for (size_t live_orders : {1000000, 10000000}) {
+        run<std_index_t>("unordered_map", live_orders);
+        run<flat_index_t>("id_map", live_orders);
+    }
+}
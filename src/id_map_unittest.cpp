@@ -0,0 +1,84 @@
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "id_map.h"
+
+/*
+ *
+ */
+TEST(IdMap, Empty) {
+    test_ns::id_map<int> map;
+    ASSERT_TRUE(map.empty());
+    ASSERT_EQ(map.find(0), nullptr);
+    ASSERT_FALSE(map.erase(0));
+}
+
+TEST(IdMap, InsertFindErase) {
+    test_ns::id_map<std::string> map;
+    ASSERT_TRUE(map.insert(0, "zero").second);
+    ASSERT_TRUE(map.insert(UINT64_MAX, "max").second);
+    map[7] = "seven";
+    ASSERT_EQ(map.size(), 3);
+
+    auto inserted = map.insert(7, "other");
+    ASSERT_FALSE(inserted.second);
+    ASSERT_EQ(*inserted.first, "seven");
+    ASSERT_EQ(*map.find(0), "zero");
+    ASSERT_EQ(*map.find(UINT64_MAX), "max");
+    ASSERT_EQ(map.find(8), nullptr);
+
+    ASSERT_TRUE(map.erase(7));
+    ASSERT_FALSE(map.erase(7));
+    ASSERT_EQ(map.find(7), nullptr);
+    ASSERT_EQ(map.size(), 2);
+    ASSERT_EQ(map[7], "");
+}
+
+TEST(IdMap, Grow) {
+    test_ns::id_map<uint64_t> map;
+    for (uint64_t id = 0; id < 100000; ++id) {
+        map[id * 3] = id;
+    }
+    ASSERT_EQ(map.size(), 100000);
+    for (uint64_t id = 0; id < 100000; ++id) {
+        ASSERT_NE(map.find(id * 3), nullptr);
+        ASSERT_EQ(*map.find(id * 3), id);
+        ASSERT_EQ(map.find(id * 3 + 1), nullptr);
+    }
+}
+
+/*
+ * Random inserts and erases on a small key range, so that probe runs
+ * wrap around the table and erases shift entries back.
+ */
+TEST(IdMap, SameAsUnorderedMap) {
+    test_ns::id_map<uint64_t> map;
+    map.reserve(64);
+    std::unordered_map<uint64_t, uint64_t> reference;
+    std::mt19937_64 random(3);
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t key = random() % 60;
+        if (random() % 2 == 0) {
+            uint64_t value = random();
+            ASSERT_EQ(map.insert(key, value).second,
+                    reference.insert(std::make_pair(key, value)).second);
+        } else {
+            ASSERT_EQ(map.erase(key), reference.erase(key) == 1);
+        }
+        ASSERT_EQ(map.size(), reference.size());
+        if (i % 64 == 0) {
+            for (uint64_t k = 0; k < 60; ++k) {
+                auto itr = reference.find(k);
+                auto value = map.find(k);
+                ASSERT_EQ(value != nullptr, itr != reference.end());
+                if (value != nullptr) {
+                    ASSERT_EQ(*value, itr->second);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#include "line_reader.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+const size_t test_ns::line_reader::read_chunk_size;
+
+/*
+ *
+ */
+test_ns::line_reader::line_reader()
+    : fd(-1), own_fd(false), map(nullptr), map_size(0),
+      buffer_begin(0), buffer_end(0), eof(false) {
+}
+
+/*
+ *
+ */
+test_ns::line_reader::~line_reader() {
+    close();
+}
+
+/*
+ *
+ */
+bool test_ns::line_reader::open(const std::string& file) {
+    close();
+    int a_fd = ::open(file.c_str(), O_RDONLY);
+    if (a_fd < 0) {
+        return false;
+    }
+    if (!open_fd(a_fd)) {
+        ::close(a_fd);
+        return false;
+    }
+    own_fd = true;
+    return true;
+}
+
+/*
+ *
+ */
+bool test_ns::line_reader::open_fd(int a_fd) {
+    close();
+    fd = a_fd;
+    own_fd = false;
+    if (!map_file()) {
+        buffer.resize(read_chunk_size);
+    }
+    return true;
+}
+
+/*
+ *
+ */
+void test_ns::line_reader::close() {
+    if (map != nullptr) {
+        ::munmap(map, map_size);
+    }
+    if (own_fd && fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    own_fd = false;
+    map = nullptr;
+    map_size = 0;
+    scanner.reset(str_view_t());
+    buffer.clear();
+    buffer_begin = buffer_end = 0;
+    eof = false;
+}
+
+/*
+ *
+ */
+bool test_ns::line_reader::is_mapped() const {
+    return map != nullptr;
+}
+
+/*
+ * The mapped text next_line() has not returned yet, which is then taken
+ * as read. Empty if the file is not mapped.
+ */
+test_ns::str_view_t test_ns::line_reader::take_unread() {
+    if (map == nullptr) {
+        return str_view_t();
+    }
+    return scanner.take_rest();
+}
+
+/*
+ * Maps the whole file if it is a regular non-empty file. Returns false
+ * when the input has to be read through the buffer instead.
+ */
+bool test_ns::line_reader::map_file() {
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return false;
+    }
+    void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+    ::madvise(addr, st.st_size, MADV_SEQUENTIAL);
+    map = static_cast<char*>(addr);
+    map_size = st.st_size;
+    scanner.reset(str_view_t(map, map_size));
+    return true;
+}
+
+/*
+ * Behaves like std::getline: a trailing newline does not produce an
+ * extra empty line, a last line without a newline is still returned.
+ */
+bool test_ns::line_reader::next_line(str_view_t* line) {
+    if (map == nullptr) {
+        return next_buffered_line(line);
+    }
+    line_commas_t commas;
+    return scanner.next_line(line, &commas);
+}
+
+/*
+ * Also gives the commas of the line, see delimiter_scanner.
+ */
+bool test_ns::line_reader::next_line(str_view_t* line,
+        line_commas_t* commas) {
+    if (map == nullptr) {
+        if (!next_buffered_line(line)) {
+            return false;
+        }
+        delimiter_scanner::find_commas(*line, commas);
+        return true;
+    }
+    return scanner.next_line(line, commas);
+}
+
+/*
+ *
+ */
+bool test_ns::line_reader::next_buffered_line(str_view_t* line) {
+    if (fd < 0) {
+        return false;
+    }
+    // number of bytes after buffer_begin already known to hold no newline
+    size_t scanned = 0;
+    for (;;) {
+        const char* begin = buffer.data() + buffer_begin;
+        auto eol = static_cast<const char*>(std::memchr(begin + scanned,
+                '\n', buffer_end - buffer_begin - scanned));
+        if (eol != nullptr) {
+            *line = str_view_t(begin, eol - begin);
+            buffer_begin = eol - buffer.data() + 1;
+            return true;
+        }
+        scanned = buffer_end - buffer_begin;
+        if (eof || !fill_buffer()) {
+            if (buffer_begin == buffer_end) {
+                return false;
+            }
+            *line = str_view_t(buffer.data() + buffer_begin,
+                    buffer_end - buffer_begin);
+            buffer_begin = buffer_end;
+            return true;
+        }
+    }
+}
+
+/*
+ * Moves the unconsumed tail to the front of the buffer, grows the buffer
+ * if a single line does not fit and reads the next chunk.
+ */
+bool test_ns::line_reader::fill_buffer() {
+    if (buffer_begin > 0) {
+        std::memmove(buffer.data(), buffer.data() + buffer_begin,
+                buffer_end - buffer_begin);
+        buffer_end -= buffer_begin;
+        buffer_begin = 0;
+    }
+    if (buffer_end == buffer.size()) {
+        buffer.resize(buffer.size() * 2);
+    }
+    for (;;) {
+        ssize_t n = ::read(fd, buffer.data() + buffer_end,
+                buffer.size() - buffer_end);
+        if (n > 0) {
+            buffer_end += n;
+            return true;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        eof = true;
+        return false;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef LINE_READER_H
+#define LINE_READER_H
+
+#include <string>
+#include <vector>
+
+#include "delimiter_scanner.h"
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Reads a file line by line without copying lines. Regular files are
+ * memory mapped, so the returned views stay valid until the reader is
+ * closed. Pipes and other non-seekable inputs are read through an
+ * internal buffer, in which case a view is only valid until the next
+ * call to next_line(). Lines of a mapped file are split by a
+ * delimiter_scanner, which finds their commas in the same pass.
+ */
+class line_reader {
+ public:
+    line_reader();
+    ~line_reader();
+    line_reader(const line_reader&) = delete;
+    line_reader& operator=(const line_reader&) = delete;
+
+    bool open(const std::string& file);
+    bool open_fd(int fd);
+    void close();
+    bool next_line(str_view_t* line);
+    bool next_line(str_view_t* line, line_commas_t*);
+    bool is_mapped() const;
+    str_view_t take_unread();
+
+ private:
+    static const size_t read_chunk_size = 1 << 20;
+    int fd;
+    bool own_fd;
+    char* map;
+    size_t map_size;
+    delimiter_scanner scanner;
+    std::vector<char> buffer;
+    size_t buffer_begin;
+    size_t buffer_end;
+    bool eof;
+    bool map_file();
+    bool next_buffered_line(str_view_t* line);
+    bool fill_buffer();
+};
+
+}  // namespace test_ns
+
+#endif  // LINE_READER_H
@@ -0,0 +1,117 @@
+#include <unistd.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "line_reader.h"
+#include "unittest_util.h"
+
+using test_ns::unittest::temp_file_t;
+
+static std::vector<std::string> read_all(test_ns::line_reader* reader) {
+    std::vector<std::string> lines;
+    test_ns::str_view_t line;
+    while (reader->next_line(&line)) {
+        lines.push_back(line.to_string());
+    }
+    return lines;
+}
+
+static std::vector<std::string> read_pipe(const std::string& content) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return {};
+    }
+    std::thread writer([&]() {
+        size_t written = 0;
+        while (written < content.size()) {
+            ssize_t n = write(fds[1], content.data() + written,
+                    content.size() - written);
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        close(fds[1]);
+    });
+    test_ns::line_reader reader;
+    reader.open_fd(fds[0]);
+    EXPECT_FALSE(reader.is_mapped());
+    auto lines = read_all(&reader);
+    writer.join();
+    close(fds[0]);
+    return lines;
+}
+
+/*
+ *
+ */
+TEST(LineReader, NoFile) {
+    test_ns::line_reader reader;
+    ASSERT_FALSE(reader.open("/tmp/line_reader_unittest.does.not.exist"));
+}
+
+TEST(LineReader, EmptyFile) {
+    temp_file_t file("");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    ASSERT_TRUE(read_all(&reader).empty());
+}
+
+TEST(LineReader, MappedLines) {
+    temp_file_t file("ORDER ADD,1,S1,Buy,20,3.33\n\nPRINT,S1\n");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    ASSERT_TRUE(reader.is_mapped());
+    auto lines = read_all(&reader);
+    ASSERT_EQ(lines.size(), 3);
+    ASSERT_EQ(lines[0], "ORDER ADD,1,S1,Buy,20,3.33");
+    ASSERT_EQ(lines[1], "");
+    ASSERT_EQ(lines[2], "PRINT,S1");
+}
+
+TEST(LineReader, MappedLastLineWithoutNewline) {
+    temp_file_t file("PRINT,S1\nPRINT,S2");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    auto lines = read_all(&reader);
+    ASSERT_EQ(lines.size(), 2);
+    ASSERT_EQ(lines[1], "PRINT,S2");
+}
+
+TEST(LineReader, TakeUnread) {
+    temp_file_t file("a,b\nc,d\ne");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    test_ns::str_view_t line;
+    ASSERT_TRUE(reader.next_line(&line));
+    ASSERT_EQ(reader.take_unread().to_string(), "c,d\ne");
+    ASSERT_FALSE(reader.next_line(&line));
+    ASSERT_TRUE(reader.take_unread().empty());
+}
+
+/*
+ *
+ */
+TEST(LineReader, PipeLines) {
+    auto lines = read_pipe("PRINT,S1\n\nPRINT,S2");
+    ASSERT_EQ(lines.size(), 3);
+    ASSERT_EQ(lines[0], "PRINT,S1");
+    ASSERT_EQ(lines[1], "");
+    ASSERT_EQ(lines[2], "PRINT,S2");
+}
+
+TEST(LineReader, PipeLongLines) {
+    std::string long_line(3 << 20, 'x');
+    std::string content;
+    for (int i = 0; i < 3; ++i) {
+        content += "PRINT,S1\n" + long_line + "\n";
+    }
+    auto lines = read_pipe(content);
+    ASSERT_EQ(lines.size(), 6);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(lines[2 * i], "PRINT,S1");
+        ASSERT_EQ(lines[2 * i + 1], long_line);
+    }
+}
@@ -0,0 +1,109 @@
+#include "line_writer.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const uint64_t powers_of_10[] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+        10000000, 100000000, 1000000000, 10000000000};
+
+#ifdef __SIZEOF_INT128__
+/*
+ * Rounds |value| to 6 significant digits the way printf does, from the
+ * exact binary value: ties go to even. Returns the digits and the
+ * decimal exponent of the first one, or false if the result would not
+ * be printed in fixed notation by "%g".
+ */
+bool round_to_6_digits(double value, uint32_t* digits, int* exponent) {
+    int binary_exponent;
+    double fraction = std::frexp(std::fabs(value), &binary_exponent);
+    // value = mantissa / 2^shift exactly
+    auto mantissa = static_cast<unsigned __int128>(
+            std::ldexp(fraction, 53));
+    int shift = 53 - binary_exponent;
+    if (shift < 1 || shift > 80) {
+        return false;
+    }
+    // first guess from the binary exponent, corrected below
+    int e = static_cast<int>(std::floor((binary_exponent - 1) * 0.30103));
+    for (;;) {
+        int scale = 5 - e;
+        if (scale < 0 || scale > 10) {
+            return false;
+        }
+        unsigned __int128 scaled = mantissa * powers_of_10[scale];
+        uint64_t whole = static_cast<uint64_t>(scaled >> shift);
+        if (whole < 100000) {
+            --e;
+            continue;
+        }
+        if (whole >= 1000000) {
+            ++e;
+            continue;
+        }
+        unsigned __int128 rest = scaled - (static_cast<unsigned __int128>(
+                whole) << shift);
+        unsigned __int128 half = static_cast<unsigned __int128>(1)
+                << (shift - 1);
+        if (rest > half || (rest == half && whole % 2 == 1)) {
+            ++whole;
+        }
+        if (whole == 1000000) {
+            whole = 100000;
+            ++e;
+        }
+        if (e < -4 || e >= 6) {
+            return false;
+        }
+        *digits = static_cast<uint32_t>(whole);
+        *exponent = e;
+        return true;
+    }
+}
+#endif
+
+}  // namespace
+
+/*
+ * Prices and averages are printed in fixed notation, which is done
+ * here. Zero, infinities, NaN and the exponent notation go to snprintf.
+ */
+void test_ns::
+line_writer::put_double(double value) {
+#ifdef __SIZEOF_INT128__
+    uint32_t digits;
+    int exponent;
+    if (value != 0 && std::isfinite(value) &&
+            round_to_6_digits(value, &digits, &exponent)) {
+        if (value < 0) {
+            put('-');
+        }
+        // digits has 6 digits, exponent + 1 of them before the point
+        int fraction = 5 - exponent;
+        while (fraction > 0 && digits % 10 == 0) {
+            digits /= 10;
+            --fraction;
+        }
+        if (exponent < 0) {
+            put('0');
+            put('.');
+            fill('0', -exponent - 1);
+            put_number(digits);
+        } else if (fraction == 0) {
+            put_number(digits);
+        } else {
+            uint32_t scale = static_cast<uint32_t>(powers_of_10[fraction]);
+            put_number(digits / scale);
+            put('.');
+            char* start = pos;
+            put_number(digits % scale + scale);
+            // drop the leading 1 of scale, keeping the zeros after it
+            std::memmove(start, start + 1, fraction);
+            --pos;
+        }
+        return;
+    }
+#endif
+    pos += std::snprintf(pos, max_double_size, "%g", value);
+}
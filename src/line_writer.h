@@ -0,0 +1,68 @@
+#ifndef LINE_WRITER_H
+#define LINE_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Formats a line into a caller provided buffer, without allocating.
+ * The output is the same as std::ostream with the default flags, fields
+ * are padded like std::left << std::setw(width). The caller makes room
+ * for the line, see the max_*_size bounds.
+ */
+class line_writer {
+ public:
+    static const size_t max_number_size = 20;
+    static const size_t max_double_size = 16;
+
+    explicit line_writer(char* buffer) : pos(buffer) {}
+
+    char* end() const {
+        return pos;
+    }
+    void put(char c) {
+        *pos++ = c;
+    }
+    void put(const str_view_t& s) {
+        std::memcpy(pos, s.data, s.size);
+        pos += s.size;
+    }
+    void put_number(uint64_t value) {
+        char digits[max_number_size];
+        char* p = digits + max_number_size;
+        do {
+            *--p = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        put(str_view_t(p, digits + max_number_size - p));
+    }
+    /*
+     * As operator<< with the default precision of 6 digits, i.e. "%g".
+     */
+    void put_double(double value);
+    void fill(char c, size_t count) {
+        std::memset(pos, c, count);
+        pos += count;
+    }
+    /*
+     * Pads the field that starts at field_start to width characters.
+     */
+    void pad(const char* field_start, size_t width) {
+        size_t size = pos - field_start;
+        if (size < width) {
+            fill(' ', width - size);
+        }
+    }
+
+ private:
+    char* pos;
+};
+
+}  // namespace test_ns
+
+#endif  // LINE_WRITER_H
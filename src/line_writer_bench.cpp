@@ -0,0 +1,116 @@
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "line_writer.h"
+#include "price.h"
+
+/*
+ * Compares line_writer with the std::ostringstream formatting it
+ * replaces, on BBO lines with tick prices and on VWAP averages.
+ */
+namespace {
+
+struct level_t {
+    uint64_t volume;
+    double price;
+};
+
+double elapsed_ns(std::chrono::steady_clock::time_point start) {
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+size_t stream_bbo(const level_t& bid, const level_t& ask) {
+    std::ostringstream ss, field1, field2;
+    ss << "BBO: " << std::left << std::setw(10) << "SYMBOL";
+    field1 << bid.volume << '@' << bid.price;
+    ss << std::left << std::setw(20) << field1.str();
+    ss << " | ";
+    field2 << ask.volume << '@' << ask.price;
+    ss << std::left << std::setw(20) << field2.str();
+    return ss.str().size();
+}
+
+size_t writer_bbo(const level_t& bid, const level_t& ask) {
+    char buffer[128];
+    test_ns::line_writer line(buffer);
+    line.put("BBO: ");
+    const char* field = line.end();
+    line.put("SYMBOL");
+    line.pad(field, 10);
+    field = line.end();
+    line.put_number(bid.volume);
+    line.put('@');
+    line.put_double(bid.price);
+    line.pad(field, 20);
+    line.put(" | ");
+    field = line.end();
+    line.put_number(ask.volume);
+    line.put('@');
+    line.put_double(ask.price);
+    line.pad(field, 20);
+    return line.end() - buffer;
+}
+
+size_t stream_vwap(const level_t& bid, const level_t& ask) {
+    std::ostringstream ss;
+    ss << "VWAP: " << std::left << std::setw(10) << "SYMBOL" << " <"
+       << bid.price << ',' << ask.price << '>';
+    return ss.str().size();
+}
+
+size_t writer_vwap(const level_t& bid, const level_t& ask) {
+    char buffer[128];
+    test_ns::line_writer line(buffer);
+    line.put("VWAP: ");
+    const char* field = line.end();
+    line.put("SYMBOL");
+    line.pad(field, 10);
+    line.put(" <");
+    line.put_double(bid.price);
+    line.put(',');
+    line.put_double(ask.price);
+    line.put('>');
+    return line.end() - buffer;
+}
+
+template<typename F>
+void run(const char* name, const std::vector<level_t>& levels, F format) {
+    const int rounds = 10;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i + 1 < levels.size(); i += 2) {
+            bytes += format(levels[i], levels[i + 1]);
+        }
+    }
+    double lines = rounds * (levels.size() / 2);
+    std::printf("%-28s %8.1f ns/line  (%zu bytes)\n", name,
+            elapsed_ns(start) / lines, bytes);
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937_64 generator(5);
+    std::vector<level_t> prices(1000000), averages(1000000);
+    for (auto & level : prices) {
+        level.volume = 1 + generator() % 10000;
+        level.price = test_ns::price_to_double(
+                100 * test_ns::price_scale + generator() % 5000000);
+    }
+    for (auto & level : averages) {
+        level.volume = 0;
+        level.price = test_ns::notional_to_double(
+                generator() % 10000000000000, 1 + generator() % 1000);
+    }
+    run("BBO ostringstream", prices, stream_bbo);
+    run("BBO line_writer", prices, writer_bbo);
+    run("VWAP ostringstream", averages, stream_vwap);
+    run("VWAP line_writer", averages, writer_vwap);
+}
@@ -0,0 +1,89 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "line_writer.h"
+#include "price.h"
+
+namespace {
+
+std::string format_double(double value) {
+    char buffer[test_ns::line_writer::max_double_size];
+    test_ns::line_writer writer(buffer);
+    writer.put_double(value);
+    return std::string(buffer, writer.end());
+}
+
+std::string stream_double(double value) {
+    std::ostringstream ss;
+    ss << value;
+    return ss.str();
+}
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(LineWriter, Fields) {
+    char buffer[128];
+    test_ns::line_writer writer(buffer);
+    const char* field = writer.end();
+    writer.put("BBO:");
+    writer.pad(field, 6);
+    field = writer.end();
+    writer.put_number(0);
+    writer.put('@');
+    writer.put_number(UINT64_MAX);
+    writer.pad(field, 4);
+    writer.fill('-', 3);
+    ASSERT_EQ(std::string(buffer, writer.end()),
+            "BBO:  0@18446744073709551615---");
+}
+
+TEST(LineWriter, Double) {
+    for (double value : {0., -0., 1., -1., 10., 0.5, 100.25, 1234.5,
+            123456., 999999., 999999.4, 999999.5, 1e6, 1234567., 0.0001,
+            0.00012345, 0.000099999, 0.00009999951, 1e-5, 2.5e-5, 1.0000005,
+            1.0000015, 0.1, 0.3, 2.675, 1e300, 5e-324,
+            std::numeric_limits<double>::infinity(),
+            -std::numeric_limits<double>::infinity(),
+            std::numeric_limits<double>::quiet_NaN()}) {
+        ASSERT_EQ(format_double(value), stream_double(value)) << value;
+    }
+}
+
+/*
+ * Ticks, averages of ticks and random bits, including exact ties at the
+ * 6th digit.
+ */
+TEST(LineWriter, SameAsStream) {
+    std::mt19937_64 random(11);
+    for (int i = 0; i < 300000; ++i) {
+        double value;
+        switch (i % 4) {
+        case 0:
+            value = test_ns::price_to_double(random() % 100000000000);
+            break;
+        case 1:
+            value = test_ns::notional_to_double(random() % 10000000000000,
+                    1 + random() % 1000);
+            break;
+        case 2:
+            value = static_cast<double>(random() % 20000000) / 16;
+            break;
+        default:
+            uint64_t bits = random();
+            std::memcpy(&value, &bits, sizeof(value));
+            break;
+        }
+        if (random() % 2 == 0) {
+            value = -value;
+        }
+        ASSERT_EQ(format_double(value), stream_double(value)) << i;
+    }
+}
@@ -0,0 +1,51 @@
+#include <iostream>
+#include <string>
+
+#include "binary_feed.h"
+#include "feed_handler.h"
+#include "line_reader.h"
+
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <csv file> <binary file>"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+
+    test_ns::line_reader reader;
+    if (!reader.open(input)) {
+        std::cerr << "File " << input << " does not exists"  << std::endl;
+        return 1;
+    }
+
+    test_ns::binary_feed_writer writer;
+    if (!writer.open(output)) {
+        std::cerr << "Cannot create " << output << std::endl;
+        return 1;
+    }
+
+    uint64_t raw_lines = 0;
+    bool ok = true;
+    test_ns::str_view_t line;
+    while (ok && reader.next_line(&line)) {
+        test_ns::command_args_t command;
+        if (test_ns::feed_handler::parse_command(line,
+                    test_ns::str_view_t(), &command) == nullptr) {
+            ok = writer.write(command, line);
+        } else {
+            ok = writer.write_raw(line);
+            ++raw_lines;
+        }
+    }
+    uint64_t records = writer.get_record_count();
+    if (!writer.close() || !ok) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    std::cerr << records << " records, " << raw_lines
+              << " kept as text" << std::endl;
+}
@@ -1,36 +1,262 @@
+#include <cstring>
 #include <iostream>
-#include <fstream>
 #include <string>
+#include <unistd.h>
 
+#include "binary_feed.h"
+#include "chunked_replay.h"
 #include "feed_handler.h"
+#include "line_reader.h"
+#include "numeric_parse.h"
+#include "replay_pipeline.h"
+#include "sharded_feed_handler.h"
 
 
-int main(int argc, char* argv[]) {
-    if (argc == 1 || argc > 3) {
-        std::cerr << "Usage: " << argv[0] << " <file> [<symbol>]" << std::endl;
+/*
+ * handler_t is feed_handler or sharded_feed_handler.
+ */
+template <typename handler_t>
+static int replay_text(const std::string& file, handler_t* a_feed_handler) {
+    test_ns::line_reader reader;
+    if (!reader.open(file)) {
+        std::cerr << "File " << file << " does not exists"  << std::endl;
         return 1;
     }
 
-    std::string symbol, file;
-    if (argc == 3) {
-        symbol = argv[2];
+    test_ns::str_view_t line;
+    test_ns::line_commas_t commas;
+    while (reader.next_line(&line, &commas)) {
+        a_feed_handler->process_command(line, commas);
     }
-    file = argv[1];
+    return 0;
+}
 
-    std::ifstream infile(file);
-    if (infile.fail()) {
+/*
+ *
+ */
+template <typename replay_t>
+static int replay_lines(const std::string& file,
+        test_ns::feed_handler* a_feed_handler, replay_t* replay) {
+    test_ns::line_reader reader;
+    if (!reader.open(file)) {
         std::cerr << "File " << file << " does not exists"  << std::endl;
         return 1;
     }
+    replay->run(&reader, a_feed_handler);
+    return 0;
+}
 
-    test_ns::callback_t a_callback = test_ns::print_to_stdout;
-    test_ns::err_callback_t an_err_callback =
-            test_ns::print_to_stderr;
+/*
+ *
+ */
+static int replay_binary(const std::string& file,
+        test_ns::feed_handler* a_feed_handler) {
+    test_ns::binary_feed_reader reader;
+    if (!reader.open(file)) {
+        std::cerr << "File " << file << " is not a binary feed"  << std::endl;
+        return 1;
+    }
+
+    test_ns::command_record_t record;
+    test_ns::str_view_t raw_line;
+    while (reader.next(a_feed_handler, &record, &raw_line)) {
+        if (record.command == test_ns::command_t::none) {
+            a_feed_handler->process_command(raw_line);
+        } else if (raw_line.empty()) {
+            a_feed_handler->process(record);
+        } else {
+            a_feed_handler->process(record, raw_line);
+        }
+    }
+    if (reader.is_corrupt()) {
+        std::cerr << "File " << file << " has a malformed record"
+                  << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * --error-summary[=<samples>] counts errors by category, only the first
+ * samples of each category are printed, 10 unless given.
+ */
+static bool parse_error_summary_option(const char* arg, uint64_t* samples) {
+    const char option[] = "--error-summary";
+    const size_t size = sizeof(option) - 1;
+    if (std::strncmp(arg, option, size) != 0) {
+        return false;
+    }
+    if (arg[size] == '\0') {
+        *samples = 10;
+        return true;
+    }
+    return arg[size] == '=' &&
+            test_ns::parse_unsigned(arg + size + 1, samples);
+}
+
+static const uint64_t max_threads = 256;
+
+/*
+ * --threads=<n> replays a text feed on n worker threads, see
+ * sharded_feed_handler.
+ */
+static bool parse_threads_option(const char* arg, uint64_t* threads) {
+    const char option[] = "--threads=";
+    const size_t size = sizeof(option) - 1;
+    return std::strncmp(arg, option, size) == 0 &&
+            test_ns::parse_unsigned(arg + size, threads) && *threads > 0 &&
+            *threads <= max_threads;
+}
+
+/*
+ * --pipeline[=<batch size>] reads, parses and applies a text feed on
+ * three threads, passing 4096 lines at a time unless given.
+ */
+static bool parse_pipeline_option(const char* arg, uint64_t* batch_size) {
+    const char option[] = "--pipeline";
+    const size_t size = sizeof(option) - 1;
+    if (std::strncmp(arg, option, size) != 0) {
+        return false;
+    }
+    if (arg[size] == '\0') {
+        *batch_size = 4096;
+        return true;
+    }
+    return arg[size] == '=' &&
+            test_ns::parse_unsigned(arg + size + 1, batch_size) &&
+            *batch_size > 0;
+}
+
+/*
+ * --parse-threads=<n> parses chunks of a mapped text feed on n threads
+ * ahead of the replay, see chunked_replay.
+ */
+static bool parse_parse_threads_option(const char* arg, uint64_t* threads) {
+    const char option[] = "--parse-threads=";
+    const size_t size = sizeof(option) - 1;
+    return std::strncmp(arg, option, size) == 0 &&
+            test_ns::parse_unsigned(arg + size, threads) && *threads > 0 &&
+            *threads <= max_threads;
+}
+
+/*
+ * --ladder[=<tick>] selects the price ladder book engine, the default
+ * tick is 0.01.
+ */
+static bool parse_ladder_option(const char* arg,
+        test_ns::book_config_t* config) {
+    const char option[] = "--ladder";
+    const size_t size = sizeof(option) - 1;
+    if (std::strncmp(arg, option, size) != 0) {
+        return false;
+    }
+    if (arg[size] == '\0') {
+        config->ladder_tick = test_ns::price_scale / 100;
+        if (config->ladder_tick == 0) {
+            config->ladder_tick = 1;
+        }
+        return true;
+    }
+    return arg[size] == '=' &&
+            test_ns::parse_price(arg + size + 1, &config->ladder_tick) &&
+            config->ladder_tick > 0;
+}
+
+int main(int argc, char* argv[]) {
+    bool binary = false;
+    bool stats = false;
+    bool summarize_errors = false;
+    uint64_t error_samples = 0;
+    uint64_t threads = 0;
+    uint64_t batch_size = 0;
+    uint64_t parse_threads = 0;
+    test_ns::book_config_t book_config;
+    int first_arg = 1;
+    for (; first_arg < argc && std::strncmp(argv[first_arg], "--", 2) == 0;
+            ++first_arg) {
+        if (std::strcmp(argv[first_arg], "--binary") == 0) {
+            binary = true;
+        } else if (std::strcmp(argv[first_arg], "--stats") == 0) {
+            stats = true;
+        } else if (parse_error_summary_option(argv[first_arg],
+                &error_samples)) {
+            summarize_errors = true;
+        } else if (!parse_threads_option(argv[first_arg], &threads) &&
+                !parse_pipeline_option(argv[first_arg], &batch_size) &&
+                !parse_parse_threads_option(argv[first_arg],
+                        &parse_threads) &&
+                !parse_ladder_option(argv[first_arg], &book_config)) {
+            first_arg = argc;
+            break;
+        }
+    }
+    // the workers of --threads keep no error summary or statistics
+    if (argc == first_arg || argc > first_arg + 2 ||
+            (threads > 0 && (binary || stats || summarize_errors)) ||
+            (batch_size > 0 && (binary || threads > 0)) ||
+            (parse_threads > 0 &&
+                (binary || threads > 0 || batch_size > 0))) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--binary] [--ladder[=<tick>]] [--stats]"
+                  << " [--error-summary[=<samples>]]"
+                  << " [--threads=<n> | --pipeline[=<batch size>] |"
+                  << " --parse-threads=<n>]"
+                  << " <file> [<symbol>]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string symbol, file;
+    if (argc == first_arg + 2) {
+        symbol = argv[first_arg + 1];
+    }
+    file = argv[first_arg];
+
+    // output is written in large chunks, it is flushed before an error
+    // so that the two streams stay in order on a terminal
+    test_ns::fd_sink output(STDOUT_FILENO);
+    test_ns::err_callback_t an_err_callback = [&output]
+        (const std::string& line, const std::string& err) {
+        output.flush();
+        test_ns::print_to_stderr(line, err);
+    };
+    if (threads > 0) {
+        test_ns::sharded_feed_handler a_feed_handler{symbol,
+            static_cast<unsigned>(threads), &output,
+            std::move(an_err_callback), book_config};
+        int result = replay_text(file, &a_feed_handler);
+        a_feed_handler.finish();
+        return result;
+    }
     test_ns::feed_handler a_feed_handler{symbol,
-        std::move(a_callback), std::move(an_err_callback)};
+        &output, std::move(an_err_callback), book_config};
+    test_ns::error_summary errors(error_samples);
+    if (summarize_errors) {
+        a_feed_handler.set_error_summary(&errors);
+    }
 
-    std::string line;
-    while (std::getline(infile, line)) {
-        a_feed_handler.process_command(line);
+    test_ns::replay_pipeline pipeline(batch_size);
+    test_ns::chunked_replay chunked(parse_threads);
+    int result = binary ? replay_binary(file, &a_feed_handler) :
+            batch_size > 0 ?
+                replay_lines(file, &a_feed_handler, &pipeline) :
+            parse_threads > 0 ?
+                replay_lines(file, &a_feed_handler, &chunked) :
+                replay_text(file, &a_feed_handler);
+    if (summarize_errors) {
+        output.flush();
+        errors.print(std::cerr);
+    }
+    if (stats) {
+        output.flush();
+        std::cerr << "VWAP recomputations avoided: "
+                  << a_feed_handler.get_avoided_vwaps_number() << std::endl;
+        if (batch_size > 0) {
+            pipeline.print_stats(std::cerr);
+        }
+        if (parse_threads > 0) {
+            chunked.print_stats(std::cerr);
+        }
     }
+    return result;
 }
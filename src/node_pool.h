@@ -0,0 +1,73 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace test_ns {
+
+/*
+ * Index of a node in a node_pool, null_node links to nothing.
+ */
+using node_index_t = uint32_t;
+const node_index_t null_node = UINT32_MAX;
+
+/*
+ * Values in one slab with prev/next links, for intrusive lists. Nodes
+ * are addressed by index, so they stay valid while the slab grows.
+ * Released nodes are kept on a free list and reused, so once the slab
+ * has grown to the peak number of live nodes allocate() and release()
+ * do not touch the heap.
+ */
+template <typename value_t>
+class node_pool {
+ public:
+    struct node_t {
+        value_t value;
+        node_index_t prev;
+        node_index_t next;
+    };
+
+    node_pool() : free_head(null_node), live(0) {}
+
+    node_index_t allocate(const value_t& value) {
+        node_index_t index = free_head;
+        if (index == null_node) {
+            index = static_cast<node_index_t>(nodes.size());
+            nodes.push_back(node_t());
+        } else {
+            free_head = nodes[index].next;
+        }
+        nodes[index].value = value;
+        nodes[index].prev = null_node;
+        nodes[index].next = null_node;
+        ++live;
+        return index;
+    }
+
+    void release(node_index_t index) {
+        nodes[index].next = free_head;
+        free_head = index;
+        --live;
+    }
+
+    node_t& operator[](node_index_t index) {
+        return nodes[index];
+    }
+    const node_t& operator[](node_index_t index) const {
+        return nodes[index];
+    }
+    size_t size() const {
+        return live;
+    }
+
+ private:
+    std::vector<node_t> nodes;
+    node_index_t free_head;
+    size_t live;
+};
+
+}  // namespace test_ns
+
+#endif  // NODE_POOL_H
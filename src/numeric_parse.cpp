@@ -0,0 +1,162 @@
+#include "numeric_parse.h"
+
+#include <limits>
+
+namespace {
+
+/*
+ *
+ */
+inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' ||
+           c == '\v' || c == '\f';
+}
+
+inline bool is_digit(char c) {
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+/*
+ * Narrows [*begin, *end) by the blanks around the number.
+ */
+inline bool trim(const test_ns::str_view_t& token,
+        const char** begin, const char** end) {
+    const char* b = token.begin();
+    const char* e = token.end();
+    while (b != e && is_blank(*b)) {
+        ++b;
+    }
+    while (e != b && is_blank(*(e - 1))) {
+        --e;
+    }
+    *begin = b;
+    *end = e;
+    return b != e;
+}
+
+}  // namespace
+
+/*
+ *
+ */
+bool test_ns::parse_unsigned(const str_view_t& token, uint64_t* value) {
+    const char* p;
+    const char* end;
+    if (!trim(token, &p, &end)) {
+        return false;
+    }
+    if (*p == '+') {
+        ++p;
+    }
+    if (p == end) {
+        return false;
+    }
+    uint64_t result = 0;
+    const uint64_t max = std::numeric_limits<uint64_t>::max();
+    for (; p != end; ++p) {
+        if (!is_digit(*p)) {
+            return false;
+        }
+        uint64_t digit = *p - '0';
+        if (result > (max - digit) / 10) {
+            return false;
+        }
+        result = result * 10 + digit;
+    }
+    *value = result;
+    return true;
+}
+
+/*
+ * Accepts [+-]digits[.digits][(e|E)[+-]digits] with at least one digit
+ * in the mantissa. The value is converted straight into ticks without
+ * going through double. Digits beyond the tick are rounded half away
+ * from zero. Prices that do not fit price_t are invalid.
+ */
+bool test_ns::parse_price(const str_view_t& token, price_t* price) {
+    const char* p;
+    const char* end;
+    if (!trim(token, &p, &end)) {
+        return false;
+    }
+    bool negative = false;
+    if (*p == '+' || *p == '-') {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // significant digits, the value is 0.digits x 10^point
+    const int max_digits = 20;
+    char digits[max_digits];
+    int count = 0;
+    int point = 0;
+    bool any_digit = false;
+    for (; p != end && is_digit(*p); ++p) {
+        any_digit = true;
+        if (count == 0 && *p == '0') {
+            continue;
+        }
+        if (count < max_digits) {
+            digits[count++] = *p;
+        }
+        ++point;
+    }
+    if (p != end && *p == '.') {
+        ++p;
+        for (; p != end && is_digit(*p); ++p) {
+            any_digit = true;
+            if (count == 0 && *p == '0') {
+                --point;
+            } else if (count < max_digits) {
+                digits[count++] = *p;
+            }
+        }
+    }
+    if (!any_digit) {
+        return false;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negative_exponent = false;
+        if (p != end && (*p == '+' || *p == '-')) {
+            negative_exponent = *p == '-';
+            ++p;
+        }
+        if (p == end || !is_digit(*p)) {
+            return false;
+        }
+        int explicit_exponent = 0;
+        for (; p != end && is_digit(*p); ++p) {
+            if (explicit_exponent < 100000) {
+                explicit_exponent = explicit_exponent * 10 + (*p - '0');
+            }
+        }
+        point += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+    if (p != end) {
+        return false;
+    }
+
+    // number of leading digits which make up the whole ticks
+    int whole = point + static_cast<int>(price_decimals);
+    if (count == 0 || whole < 0) {
+        *price = 0;
+        return true;
+    }
+    if (whole >= max_digits) {
+        return false;
+    }
+    uint64_t ticks = 0;
+    for (int i = 0; i < whole; ++i) {
+        ticks = ticks * 10 + (i < count ? digits[i] - '0' : 0);
+    }
+    if (whole < count && digits[whole] >= '5') {
+        ++ticks;
+    }
+    if (ticks > static_cast<uint64_t>(std::numeric_limits<price_t>::max())) {
+        return false;
+    }
+    *price = negative ? -static_cast<price_t>(ticks)
+                      : static_cast<price_t>(ticks);
+    return true;
+}
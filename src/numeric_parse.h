@@ -0,0 +1,21 @@
+#ifndef NUMERIC_PARSE_H
+#define NUMERIC_PARSE_H
+
+#include <cstdint>
+
+#include "price.h"
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Locale-independent field parsers. Leading and trailing blanks are
+ * skipped, anything else that is not part of the number makes the
+ * field invalid, as does a value that does not fit the result type.
+ */
+bool parse_unsigned(const str_view_t& token, uint64_t* value);
+bool parse_price(const str_view_t& token, price_t* price);
+
+}  // namespace test_ns
+
+#endif  // NUMERIC_PARSE_H
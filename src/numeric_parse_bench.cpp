@@ -0,0 +1,74 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "numeric_parse.h"
+
+/*
+ * Compares the hand-rolled field parsers with the std::istringstream
+ * conversions they replace, on order id, quantity and price shaped input.
+ */
+namespace {
+
+template<typename T>
+bool stream_parse(const test_ns::str_view_t& token, T* value) {
+    std::istringstream ss(token.to_string());
+    ss >> *value;
+    return static_cast<bool>(ss);
+}
+
+template<typename F>
+void run(const char* name, const std::vector<std::string>& fields, F parse) {
+    const int rounds = 20;
+    double sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (auto const & field : fields) {
+            sum += parse(test_ns::str_view_t(field));
+        }
+    }
+    auto stop = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    std::printf("%-28s %8.1f ns/field  (checksum %g)\n", name,
+            ns / (rounds * fields.size()), sum);
+}
+
+}  // namespace
+
+int main() {
+    std::mt19937_64 generator(1);
+    std::vector<std::string> ids, quantities, prices;
+    char buffer[64];
+    for (int i = 0; i < 200000; ++i) {
+        ids.push_back(std::to_string(generator() % 100000000000ULL));
+        quantities.push_back(std::to_string(1 + generator() % 10000));
+        std::snprintf(buffer, sizeof(buffer), "%.2f",
+                (generator() % 2000000) / 100.);
+        prices.push_back(buffer);
+    }
+
+    run("order id   istringstream", ids, [](const test_ns::str_view_t& t) {
+        uint64_t v = 0; stream_parse(t, &v); return double(v);
+    });
+    run("order id   parse_unsigned", ids, [](const test_ns::str_view_t& t) {
+        uint64_t v = 0; test_ns::parse_unsigned(t, &v); return double(v);
+    });
+    run("quantity   istringstream", quantities,
+            [](const test_ns::str_view_t& t) {
+        uint64_t v = 0; stream_parse(t, &v); return double(v);
+    });
+    run("quantity   parse_unsigned", quantities,
+            [](const test_ns::str_view_t& t) {
+        uint64_t v = 0; test_ns::parse_unsigned(t, &v); return double(v);
+    });
+    run("price      istringstream", prices, [](const test_ns::str_view_t& t) {
+        double v = 0; stream_parse(t, &v); return v;
+    });
+    run("price      parse_price", prices, [](const test_ns::str_view_t& t) {
+        test_ns::price_t v = 0; test_ns::parse_price(t, &v); return double(v);
+    });
+}
@@ -0,0 +1,100 @@
+#include <string>
+
+#include "gtest/gtest.h"
+#include "numeric_parse.h"
+
+/*
+ *
+ */
+TEST(NumericParse, Unsigned) {
+    uint64_t value = 0;
+    ASSERT_TRUE(test_ns::parse_unsigned("0", &value));
+    ASSERT_EQ(value, 0);
+    ASSERT_TRUE(test_ns::parse_unsigned("12", &value));
+    ASSERT_EQ(value, 12);
+    ASSERT_TRUE(test_ns::parse_unsigned("+12", &value));
+    ASSERT_EQ(value, 12);
+    ASSERT_TRUE(test_ns::parse_unsigned(" 12\r", &value));
+    ASSERT_EQ(value, 12);
+    ASSERT_TRUE(test_ns::parse_unsigned("18446744073709551615", &value));
+    ASSERT_EQ(value, 18446744073709551615ULL);
+}
+
+TEST(NumericParse, UnsignedInvalid) {
+    uint64_t value = 0;
+    ASSERT_FALSE(test_ns::parse_unsigned("", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned(" ", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("+", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("-1", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("12abc", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("1.5", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("1 2", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("INCORRECT_ID", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("18446744073709551616", &value));
+    ASSERT_FALSE(test_ns::parse_unsigned("99999999999999999999", &value));
+}
+
+TEST(NumericParse, Price) {
+    const test_ns::price_t scale = test_ns::price_scale;
+    test_ns::price_t price = 0;
+    ASSERT_TRUE(test_ns::parse_price("3.33", &price));
+    ASSERT_EQ(price, 333 * scale / 100);
+    ASSERT_TRUE(test_ns::parse_price("10.", &price));
+    ASSERT_EQ(price, 10 * scale);
+    ASSERT_TRUE(test_ns::parse_price(".5", &price));
+    ASSERT_EQ(price, scale / 2);
+    ASSERT_TRUE(test_ns::parse_price("-2.5", &price));
+    ASSERT_EQ(price, -25 * scale / 10);
+    ASSERT_TRUE(test_ns::parse_price(" +72.81 ", &price));
+    ASSERT_EQ(price, 7281 * scale / 100);
+    ASSERT_TRUE(test_ns::parse_price("1e2", &price));
+    ASSERT_EQ(price, 100 * scale);
+    ASSERT_TRUE(test_ns::parse_price("125E-3", &price));
+    ASSERT_EQ(price, 125 * scale / 1000);
+    ASSERT_TRUE(test_ns::parse_price("0.000", &price));
+    ASSERT_EQ(price, 0);
+    ASSERT_TRUE(test_ns::parse_price("10.10", &price));
+    test_ns::price_t other = 0;
+    ASSERT_TRUE(test_ns::parse_price("10.1", &other));
+    ASSERT_EQ(price, other);
+}
+
+TEST(NumericParse, PriceRounding) {
+    const std::string half_tick =
+            "0." + std::string(test_ns::price_decimals, '0') + "5";
+    const std::string below_half_tick =
+            "0." + std::string(test_ns::price_decimals, '0') + "4999";
+    test_ns::price_t price = 0;
+    ASSERT_TRUE(test_ns::parse_price(half_tick, &price));
+    ASSERT_EQ(price, 1);
+    ASSERT_TRUE(test_ns::parse_price("-" + half_tick, &price));
+    ASSERT_EQ(price, -1);
+    ASSERT_TRUE(test_ns::parse_price(below_half_tick, &price));
+    ASSERT_EQ(price, 0);
+    ASSERT_TRUE(test_ns::parse_price("1e-30", &price));
+    ASSERT_EQ(price, 0);
+}
+
+TEST(NumericParse, PriceInvalid) {
+    test_ns::price_t price = 0;
+    ASSERT_FALSE(test_ns::parse_price("", &price));
+    ASSERT_FALSE(test_ns::parse_price(".", &price));
+    ASSERT_FALSE(test_ns::parse_price("-", &price));
+    ASSERT_FALSE(test_ns::parse_price("1e", &price));
+    ASSERT_FALSE(test_ns::parse_price("3.33x", &price));
+    ASSERT_FALSE(test_ns::parse_price("3..3", &price));
+    ASSERT_FALSE(test_ns::parse_price("inf", &price));
+    ASSERT_FALSE(test_ns::parse_price("nan", &price));
+    ASSERT_FALSE(test_ns::parse_price("1e400", &price));
+    ASSERT_FALSE(test_ns::parse_price("99999999999999999999", &price));
+}
+
+TEST(NumericParse, PriceToString) {
+    const test_ns::price_t scale = test_ns::price_scale;
+    ASSERT_EQ(test_ns::price_to_string(0), "0");
+    ASSERT_EQ(test_ns::price_to_string(10 * scale), "10");
+    ASSERT_EQ(test_ns::price_to_string(333 * scale / 100), "3.33");
+    ASSERT_EQ(test_ns::price_to_string(-25 * scale / 10), "-2.5");
+    ASSERT_EQ(test_ns::price_to_double(7281 * scale / 100), 72.81);
+    ASSERT_EQ(test_ns::double_to_price(72.81), 7281 * scale / 100);
+}
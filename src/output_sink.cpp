@@ -0,0 +1,132 @@
+#include "output_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+/*
+ *
+ */
+test_ns::
+output_sink::output_sink(size_t a_flush_size)
+    : buffer(a_flush_size + 256), used(0), flush_size(a_flush_size) {
+}
+
+/*
+ * Derived sinks flush in their destructors, write_out() can not be
+ * called from here.
+ */
+test_ns::
+output_sink::~output_sink() {
+}
+
+/*
+ *
+ */
+void test_ns::
+output_sink::flush() {
+    if (used == 0) {
+        return;
+    }
+    write_out(buffer.data(), used);
+    used = 0;
+}
+
+/*
+ * A line longer than the spare room, the buffer is not shrunk again.
+ */
+void test_ns::
+output_sink::grow(size_t size) {
+    buffer.resize(std::max(size, buffer.size() * 2));
+}
+
+/*
+ *
+ */
+test_ns::
+fd_sink::fd_sink(int a_fd, size_t flush_size)
+    : output_sink(flush_size), fd(a_fd), failed(false) {
+}
+
+/*
+ *
+ */
+test_ns::
+fd_sink::~fd_sink() {
+    flush();
+}
+
+/*
+ * A short write is resumed. After an error the rest of the output is
+ * dropped, e.g. stdout is a closed pipe.
+ */
+void test_ns::
+fd_sink::write_out(const char* data, size_t size) {
+    while (size != 0 && !failed) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno != EINTR) {
+                failed = true;
+            }
+            continue;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+/*
+ * Every line is handed over when it is ended.
+ */
+test_ns::
+callback_sink::callback_sink(line_callback_t&& a_callback)
+    : output_sink(1), callback(std::move(a_callback)) {
+}
+
+/*
+ *
+ */
+test_ns::
+callback_sink::~callback_sink() {
+    flush();
+}
+
+/*
+ *
+ */
+void test_ns::
+callback_sink::write_out(const char* data, size_t size) {
+    const char* end = data + size;
+    while (data != end) {
+        auto eol = static_cast<const char*>(
+                std::memchr(data, '\n', end - data));
+        line.assign(data, eol - data);
+        callback(line);
+        data = eol + 1;
+    }
+}
+
+/*
+ *
+ */
+test_ns::
+string_sink::string_sink(std::string* a_text, size_t flush_size)
+    : output_sink(flush_size), text(a_text) {
+}
+
+/*
+ *
+ */
+test_ns::
+string_sink::~string_sink() {
+    flush();
+}
+
+/*
+ *
+ */
+void test_ns::
+string_sink::write_out(const char* data, size_t size) {
+    text->append(data, size);
+}
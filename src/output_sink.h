@@ -0,0 +1,133 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Collects output lines in one reusable buffer. Appending is not
+ * virtual, the buffer is handed to write_out() once it holds at least
+ * flush_size bytes, on flush() and on destruction of the derived sink.
+ * write_out() gets whole lines only, each ended by '\n'.
+ */
+class output_sink {
+ public:
+    explicit output_sink(size_t flush_size);
+    virtual ~output_sink();
+    output_sink(const output_sink&) = delete;
+    output_sink& operator=(const output_sink&) = delete;
+
+    /*
+     * Room for size more bytes at the end of the buffer, for a line
+     * formatted in place. commit() then tells where the line ended.
+     */
+    char* reserve(size_t size) {
+        if (used + size > buffer.size()) {
+            grow(used + size);
+        }
+        return buffer.data() + used;
+    }
+    void commit(const char* end) {
+        used = end - buffer.data();
+    }
+    void append(const char* data, size_t size) {
+        std::memcpy(reserve(size), data, size);
+        used += size;
+    }
+    void append(const str_view_t& s) {
+        append(s.data, s.size);
+    }
+    void end_line() {
+        *reserve(1) = '\n';
+        ++used;
+        if (used >= flush_size) {
+            flush();
+        }
+    }
+    void write_line(const str_view_t& line) {
+        append(line);
+        end_line();
+    }
+    /*
+     * Lines that are already ended by '\n'.
+     */
+    void write_lines(const str_view_t& lines) {
+        append(lines);
+        if (used >= flush_size) {
+            flush();
+        }
+    }
+    void flush();
+
+ protected:
+    virtual void write_out(const char* data, size_t size) = 0;
+
+ private:
+    std::vector<char> buffer;
+    size_t used;
+    size_t flush_size;
+    void grow(size_t size);
+};
+
+/*
+ * Writes to a file descriptor in chunks of about 64K with write(2).
+ */
+class fd_sink : public output_sink {
+ public:
+    explicit fd_sink(int fd, size_t flush_size = 1 << 16);
+    ~fd_sink();
+    bool has_failed() const {
+        return failed;
+    }
+
+ protected:
+    void write_out(const char* data, size_t size) override;
+
+ private:
+    int fd;
+    bool failed;
+};
+
+/*
+ * Passes every line to a callback, without its '\n', as soon as it is
+ * ended. Adapts the std::function callbacks of feed_handler.
+ */
+class callback_sink : public output_sink {
+ public:
+    using line_callback_t = std::function<void(const std::string&)>;
+    explicit callback_sink(line_callback_t&&);
+    ~callback_sink();
+
+ protected:
+    void write_out(const char* data, size_t size) override;
+
+ private:
+    line_callback_t callback;
+    std::string line;
+};
+
+/*
+ * Appends the output to a string, for output which is passed on later.
+ */
+class string_sink : public output_sink {
+ public:
+    explicit string_sink(std::string* text, size_t flush_size = 1 << 16);
+    ~string_sink();
+
+ protected:
+    void write_out(const char* data, size_t size) override;
+
+ private:
+    std::string* text;
+};
+
+}  // namespace test_ns
+
+#endif  // OUTPUT_SINK_H
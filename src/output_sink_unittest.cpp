@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "output_sink.h"
+
+namespace {
+
+/*
+ * Keeps the chunks handed to write_out().
+ */
+class test_sink : public test_ns::output_sink {
+ public:
+    explicit test_sink(size_t flush_size) : output_sink(flush_size) {}
+    ~test_sink() { flush(); }
+    std::vector<std::string> chunks;
+
+ protected:
+    void write_out(const char* data, size_t size) override {
+        chunks.push_back(std::string(data, size));
+    }
+};
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(OutputSink, Batches) {
+    test_sink sink(10);
+    sink.write_line("abc");
+    sink.append("de", 2);
+    sink.append(test_ns::str_view_t("f"));
+    sink.end_line();
+    ASSERT_TRUE(sink.chunks.empty());
+    sink.write_line("gh");
+    ASSERT_EQ(sink.chunks, (std::vector<std::string>{"abc\ndef\ngh\n"}));
+    sink.write_line("");
+    sink.flush();
+    sink.flush();
+    ASSERT_EQ(sink.chunks,
+            (std::vector<std::string>{"abc\ndef\ngh\n", "\n"}));
+}
+
+TEST(OutputSink, Callback) {
+    std::vector<std::string> lines;
+    test_ns::callback_sink sink([&lines](const std::string& s) {
+        lines.push_back(s);
+    });
+    sink.write_line("one");
+    ASSERT_EQ(lines, (std::vector<std::string>{"one"}));
+    sink.append("tw", 2);
+    ASSERT_EQ(lines.size(), 1);
+    sink.append("o", 1);
+    sink.end_line();
+    sink.write_line("");
+    ASSERT_EQ(lines, (std::vector<std::string>{"one", "two", ""}));
+}
+
+TEST(OutputSink, FileDescriptor) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    {
+        test_ns::fd_sink sink(fds[1], 8);
+        sink.write_line("123");
+        sink.write_line("4567");
+        sink.write_line("89");
+    }
+    close(fds[1]);
+    char buffer[64];
+    std::string read_back;
+    ssize_t size;
+    while ((size = read(fds[0], buffer, sizeof(buffer))) > 0) {
+        read_back.append(buffer, size);
+    }
+    close(fds[0]);
+    ASSERT_EQ(read_back, "123\n4567\n89\n");
+}
+
+TEST(OutputSink, String) {
+    std::string text;
+    test_ns::string_sink sink(&text, 8);
+    sink.write_line("one");
+    ASSERT_EQ(text, "");
+    sink.write_lines("two\nthree\n");
+    ASSERT_EQ(text, "one\ntwo\nthree\n");
+    sink.write_line("four");
+    sink.flush();
+    ASSERT_EQ(text, "one\ntwo\nthree\nfour\n");
+}
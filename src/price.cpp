@@ -0,0 +1,59 @@
+#include "price.h"
+
+#include <cmath>
+
+/*
+ * Ticks and the scale are exact as doubles, so one division gives the
+ * correctly rounded value, the same double strtod() gives for the text.
+ */
+double test_ns::price_to_double(price_t price) {
+    return static_cast<double>(price) / price_scale;
+}
+
+/*
+ *
+ */
+test_ns::price_t test_ns::double_to_price(double value) {
+    return static_cast<price_t>(std::llround(value * price_scale));
+}
+
+/*
+ *
+ */
+std::string test_ns::price_to_string(price_t price) {
+    char buffer[32];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    bool negative = price < 0;
+    uint64_t ticks = negative ? 0 - static_cast<uint64_t>(price)
+                              : static_cast<uint64_t>(price);
+    unsigned fraction = 0;
+    bool significant = false;
+    for (; fraction < price_decimals; ++fraction) {
+        unsigned digit = ticks % 10;
+        ticks /= 10;
+        if (digit != 0 || significant) {
+            *--p = static_cast<char>('0' + digit);
+            significant = true;
+        }
+    }
+    if (significant) {
+        *--p = '.';
+    }
+    do {
+        *--p = static_cast<char>('0' + ticks % 10);
+        ticks /= 10;
+    } while (ticks != 0);
+    if (negative) {
+        *--p = '-';
+    }
+    return std::string(p, end);
+}
+
+/*
+ *
+ */
+double test_ns::notional_to_double(notional_t notional, uint64_t quantity) {
+    return static_cast<double>(notional) /
+            (static_cast<double>(quantity) * price_scale);
+}
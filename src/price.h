@@ -0,0 +1,65 @@
+#ifndef PRICE_H
+#define PRICE_H
+
+#include <cstdint>
+#include <string>
+
+/*
+ * Number of decimal places kept by a price, one tick is
+ * 10^-PRICE_DECIMALS. Can be overridden at build time, e.g.
+ * make EXTRA_CXXFLAGS=-DPRICE_DECIMALS=4.
+ */
+#ifndef PRICE_DECIMALS
+#define PRICE_DECIMALS 6
+#endif
+
+static_assert(PRICE_DECIMALS >= 0 && PRICE_DECIMALS <= 9,
+        "PRICE_DECIMALS must be between 0 and 9");
+
+namespace test_ns {
+
+/*
+ * Fixed-point price, a signed number of ticks. Prices are parsed
+ * straight into ticks and only converted to double when printed.
+ */
+using price_t = int64_t;
+
+/*
+ * Sum of price x quantity products, in ticks. 128 bits cannot overflow
+ * for any realistic book; without __int128 it degrades to long double.
+ */
+#ifdef __SIZEOF_INT128__
+using notional_t = __int128;
+#else
+using notional_t = long double;
+#endif
+
+const unsigned price_decimals = PRICE_DECIMALS;
+
+/*
+ * Ticks per unit of price.
+ */
+constexpr price_t price_scale_for(unsigned decimals) {
+    return decimals == 0 ? 1 : 10 * price_scale_for(decimals - 1);
+}
+const price_t price_scale = price_scale_for(PRICE_DECIMALS);
+
+/*
+ * Conversions, double_to_price() rounds to the nearest tick.
+ */
+double price_to_double(price_t price);
+price_t double_to_price(double value);
+
+/*
+ * Exact decimal text of a price, without trailing zeros.
+ */
+std::string price_to_string(price_t price);
+
+/*
+ * Average price of quantity units costing notional ticks in total.
+ */
+double notional_to_double(notional_t notional, uint64_t quantity);
+
+}  // namespace test_ns
+
+#endif  // PRICE_H
@@ -0,0 +1,482 @@
+#ifndef PRICE_LEVELS_H
+#define PRICE_LEVELS_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "node_pool.h"
+#include "price.h"
+
+namespace test_ns {
+
+/*
+ * How order books store their price levels, chosen once per run.
+ *
+ * With ladder_tick == 0 every level lives in a std::map (the tree
+ * engine). Otherwise a level whose price is a multiple of ladder_tick
+ * lives in a dense array of ladder_size slots, one per tick, centred on
+ * the touch; all other levels fall back to the map. Both engines give
+ * the same results.
+ */
+struct book_config_t {
+    price_t ladder_tick = 0;
+    unsigned ladder_size = 1024;
+};
+
+/*
+ * Orders resting at one price in time priority and their total volume,
+ * kept up to date on every change so that a level is never summed up
+ * again. The orders are a FIFO queue linked through the nodes of the
+ * book's node_pool, so an order is unlinked in O(1).
+ */
+struct book_level_t {
+    uint64_t volume = 0;
+    size_t orders = 0;
+    node_index_t head = null_node;
+    node_index_t tail = null_node;
+    bool empty() const { return orders == 0; }
+
+    template <typename pool_t>
+    void push_back(pool_t* pool, node_index_t node) {
+        (*pool)[node].prev = tail;
+        (*pool)[node].next = null_node;
+        if (tail == null_node) {
+            head = node;
+        } else {
+            (*pool)[tail].next = node;
+        }
+        tail = node;
+        ++orders;
+    }
+
+    template <typename pool_t>
+    void unlink(pool_t* pool, node_index_t node) {
+        node_index_t prev = (*pool)[node].prev;
+        node_index_t next = (*pool)[node].next;
+        if (prev == null_node) {
+            head = next;
+        } else {
+            (*pool)[prev].next = next;
+        }
+        if (next == null_node) {
+            tail = prev;
+        } else {
+            (*pool)[next].prev = prev;
+        }
+        --orders;
+    }
+};
+
+/*
+ * One side of an order book, levels ordered from the best price down.
+ * better_t is std::greater<price_t> for bids and std::less<price_t>
+ * for asks.
+ *
+ * The ladder keeps the index of its best slot and the number of used
+ * slots, so adding to or removing from a ladder level and reading the
+ * top of the book are O(1); only removing the best level scans for the
+ * next one. When the touch moves out of the window the ladder is
+ * recentred on it, levels leaving the window go to the map and levels
+ * entering it come back from the map.
+ *
+ * The ladder also keeps a depth index, Fenwick trees of the volume and
+ * of the notional of its slots in book order, updated on every change
+ * of a slot. get_cost() uses it to find where a quantity is filled in
+ * O(log ladder_size), plus one step per map level it passes.
+ */
+template <typename better_t>
+class price_levels {
+ public:
+    class const_iterator {
+     public:
+        price_t price() const {
+            return at_slot ? owner->slot_price(slot) : overflow_itr->first;
+        }
+        const book_level_t& level() const {
+            return at_slot ? owner->slots[slot] : overflow_itr->second;
+        }
+        const_iterator& operator++() {
+            if (at_slot) {
+                if (--slots_left != 0) {
+                    slot = owner->next_used_slot(slot);
+                }
+            } else {
+                ++overflow_itr;
+            }
+            select();
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const {
+            return slots_left == other.slots_left &&
+                    overflow_itr == other.overflow_itr &&
+                    (slots_left == 0 || slot == other.slot);
+        }
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+     private:
+        friend class price_levels;
+        using overflow_itr_t =
+                typename std::map<price_t, book_level_t,
+                        better_t>::const_iterator;
+        const price_levels* owner;
+        size_t slot;
+        size_t slots_left;
+        overflow_itr_t overflow_itr;
+        bool at_slot;
+        const_iterator(const price_levels* owner, size_t slot,
+                size_t slots_left, overflow_itr_t overflow_itr)
+            : owner(owner), slot(slot), slots_left(slots_left),
+              overflow_itr(overflow_itr) {
+            select();
+        }
+        void select() {
+            at_slot = slots_left != 0 &&
+                    (overflow_itr == owner->overflow.end() ||
+                     better_t()(owner->slot_price(slot),
+                             overflow_itr->first));
+        }
+    };
+
+    explicit price_levels(const book_config_t& config)
+        : tick(config.ladder_tick), size(config.ladder_size),
+          anchor(0), used(0), best(0) {
+        if (size == 0) {
+            tick = 0;
+        }
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, best, used, overflow.begin());
+    }
+    const_iterator end() const {
+        return const_iterator(this, 0, 0, overflow.end());
+    }
+    bool empty() const {
+        return used == 0 && overflow.empty();
+    }
+    bool has_depth_index() const {
+        return tick != 0;
+    }
+
+    /*
+     * Cost of the best quantity units of the side, the last level is
+     * taken partially. reach is the price of that last level. Returns
+     * false if the side holds less. Needs the depth index.
+     */
+    bool get_cost(uint64_t quantity, notional_t* cost,
+            price_t* reach) const {
+        if (quantity == 0) {
+            *cost = 0;
+            if (empty()) {
+                return false;
+            }
+            *reach = begin().price();
+            return true;
+        }
+        uint64_t found = 0;
+        notional_t total = 0;
+        size_t done = 0;    // slot positions taken
+        auto itr = overflow.begin();
+        for (;;) {
+            size_t limit = slots.size();
+            if (itr != overflow.end()) {
+                limit = slots_better_than(itr->first);
+            }
+            if (limit > done) {
+                depth_sum_t from = depth_prefix(done);
+                depth_sum_t to = depth_prefix(limit);
+                uint64_t need = quantity - found;
+                if (to.volume - from.volume >= need) {
+                    size_t position;
+                    depth_sum_t before = depth_search(from.volume + need,
+                            &position);
+                    price_t price = slot_price(slot_at(position));
+                    *cost = total + (before.notional - from.notional) +
+                            static_cast<notional_t>(
+                                    need - (before.volume - from.volume)) *
+                            price;
+                    *reach = price;
+                    return true;
+                }
+                found += to.volume - from.volume;
+                total += to.notional - from.notional;
+                done = limit;
+            }
+            if (itr == overflow.end()) {
+                return false;
+            }
+            uint64_t volume = itr->second.volume;
+            if (quantity - found <= volume) {
+                *cost = total + static_cast<notional_t>(quantity - found) *
+                        itr->first;
+                *reach = itr->first;
+                return true;
+            }
+            found += volume;
+            total += static_cast<notional_t>(volume) * itr->first;
+            ++itr;
+        }
+    }
+
+    /*
+     * Queues node, an order of quantity, at the back of its level.
+     */
+    template <typename pool_t>
+    void add(price_t price, node_index_t node, uint64_t quantity,
+            pool_t* pool) {
+        book_level_t* level = find_slot(price);
+        if (level == nullptr && is_on_grid(price) &&
+                (used == 0 || better_t()(price, slot_price(best)))) {
+            recentre(price);
+            level = find_slot(price);
+        }
+        if (level == nullptr) {
+            level = &overflow[price];
+        } else {
+            size_t index = level - slots.data();
+            if (level->empty()) {
+                if (used == 0 || is_better_slot(index, best)) {
+                    best = index;
+                }
+                ++used;
+            }
+            depth_add(index, quantity, price);
+        }
+        level->push_back(pool, node);
+        level->volume += quantity;
+    }
+
+    /*
+     * Unlinks node, an order of quantity resting at price.
+     */
+    template <typename pool_t>
+    void remove(price_t price, node_index_t node, uint64_t quantity,
+            pool_t* pool) {
+        book_level_t* level = find_slot(price);
+        if (level == nullptr) {
+            auto itr = overflow.find(price);
+            assert(itr != overflow.end());
+            itr->second.unlink(pool, node);
+            itr->second.volume -= quantity;
+            if (itr->second.empty()) {
+                overflow.erase(itr);
+            }
+            return;
+        }
+        level->unlink(pool, node);
+        level->volume -= quantity;
+        depth_add(level - slots.data(), 0 - quantity, price);
+        if (!level->empty()) {
+            return;
+        }
+        level->volume = 0;
+        if (--used == 0) {
+            if (!overflow.empty() && is_on_grid(overflow.begin()->first)) {
+                recentre(overflow.begin()->first);
+            }
+        } else if (static_cast<size_t>(level - slots.data()) == best) {
+            best = next_used_slot(best);
+        }
+    }
+
+ private:
+    using overflow_t = std::map<price_t, book_level_t, better_t>;
+    price_t tick;
+    size_t size;
+    price_t anchor;     // price of slots[0]
+    std::vector<book_level_t> slots;
+    size_t used;        // slots with orders
+    size_t best;        // best used slot, valid if used != 0
+    overflow_t overflow;
+    // Fenwick trees over slot positions, position 0 is the best slot
+    std::vector<uint64_t> depth_volume;
+    std::vector<notional_t> depth_notional;
+
+    struct depth_sum_t {
+        uint64_t volume;
+        notional_t notional;
+    };
+
+    static bool higher_is_better() {
+        return better_t()(1, 0);
+    }
+    price_t slot_price(size_t index) const {
+        return anchor + static_cast<price_t>(index) * tick;
+    }
+    bool is_better_slot(size_t a, size_t b) const {
+        return higher_is_better() ? a > b : a < b;
+    }
+    /*
+     * Prices far from zero stay in the map, so that slot prices cannot
+     * overflow.
+     */
+    bool is_on_grid(price_t price) const {
+        const price_t limit = std::numeric_limits<price_t>::max() / 4;
+        return tick != 0 && price % tick == 0 &&
+                price > -limit && price < limit;
+    }
+    book_level_t* find_slot(price_t price) {
+        if (slots.empty() || !is_on_grid(price)) {
+            return nullptr;
+        }
+        price_t index = (price - anchor) / tick;
+        if (index < 0 || index >= static_cast<price_t>(size)) {
+            return nullptr;
+        }
+        return &slots[index];
+    }
+    /*
+     * The next used slot below index in book order, there must be one.
+     */
+    size_t next_used_slot(size_t index) const {
+        do {
+            index = higher_is_better() ? index - 1 : index + 1;
+        } while (slots[index].empty());
+        return index;
+    }
+    size_t slot_at(size_t position) const {
+        return higher_is_better() ? size - 1 - position : position;
+    }
+    /*
+     * Number of slots with a better price than price.
+     */
+    size_t slots_better_than(price_t price) const {
+        if (slots.empty()) {
+            return 0;
+        }
+        price_t low = anchor;
+        price_t high = slot_price(size - 1);
+        if (higher_is_better()) {
+            if (price < low) {
+                return size;
+            }
+            if (price >= high) {
+                return 0;
+            }
+            return size - 1 - static_cast<size_t>((price - low) / tick);
+        }
+        if (price <= low) {
+            return 0;
+        }
+        if (price > high) {
+            return size;
+        }
+        return static_cast<size_t>((price - low + tick - 1) / tick);
+    }
+    /*
+     * volume is added modulo 2^64, so that it can be negative.
+     */
+    void depth_add(size_t index, uint64_t volume, price_t price) {
+        notional_t notional = static_cast<notional_t>(
+                static_cast<int64_t>(volume)) * price;
+        for (size_t i = slot_at(index) + 1; i <= size; i += i & (0 - i)) {
+            depth_volume[i] += volume;
+            depth_notional[i] += notional;
+        }
+    }
+    /*
+     * Sums of the first count positions.
+     */
+    depth_sum_t depth_prefix(size_t count) const {
+        depth_sum_t sum = {0, 0};
+        for (size_t i = count; i != 0; i -= i & (0 - i)) {
+            sum.volume += depth_volume[i];
+            sum.notional += depth_notional[i];
+        }
+        return sum;
+    }
+    /*
+     * The first position where the running volume reaches volume, and
+     * the sums of the positions before it.
+     */
+    depth_sum_t depth_search(uint64_t volume, size_t* position) const {
+        depth_sum_t sum = {0, 0};
+        size_t i = 0;
+        size_t step = 1;
+        while (step * 2 <= size) {
+            step *= 2;
+        }
+        for (; step != 0; step /= 2) {
+            if (i + step <= size &&
+                    sum.volume + depth_volume[i + step] < volume) {
+                i += step;
+                sum.volume += depth_volume[i];
+                sum.notional += depth_notional[i];
+            }
+        }
+        *position = i;
+        return sum;
+    }
+    /*
+     * Rebuilds the depth index from the slots in O(ladder_size).
+     */
+    void depth_rebuild() {
+        depth_volume.assign(size + 1, 0);
+        depth_notional.assign(size + 1, 0);
+        for (size_t i = 1; i <= size; ++i) {
+            size_t index = slot_at(i - 1);
+            depth_volume[i] += slots[index].volume;
+            depth_notional[i] += static_cast<notional_t>(
+                    slots[index].volume) * slot_price(index);
+            size_t parent = i + (i & (0 - i));
+            if (parent <= size) {
+                depth_volume[parent] += depth_volume[i];
+                depth_notional[parent] += depth_notional[i];
+            }
+        }
+    }
+    /*
+     * Moves the window so that it is centred on price, a multiple of
+     * tick.
+     */
+    void recentre(price_t price) {
+        std::vector<book_level_t> old_slots(size);
+        old_slots.swap(slots);
+        price_t old_anchor = anchor;
+        anchor = price - static_cast<price_t>(size / 2) * tick;
+        used = 0;
+        for (size_t i = 0; i < old_slots.size(); ++i) {
+            if (old_slots[i].empty()) {
+                continue;
+            }
+            price_t old_price = old_anchor + static_cast<price_t>(i) * tick;
+            book_level_t* level = find_slot(old_price);
+            if (level == nullptr) {
+                level = &overflow[old_price];
+            } else {
+                ++used;
+            }
+            *level = std::move(old_slots[i]);
+        }
+        price_t low = anchor;
+        price_t high = slot_price(size - 1);
+        auto itr = overflow.lower_bound(higher_is_better() ? high : low);
+        auto last = overflow.upper_bound(higher_is_better() ? low : high);
+        while (itr != last) {
+            book_level_t* level = find_slot(itr->first);
+            if (level == nullptr) {
+                ++itr;
+                continue;
+            }
+            *level = std::move(itr->second);
+            ++used;
+            itr = overflow.erase(itr);
+        }
+        if (used != 0) {
+            best = higher_is_better() ? size : static_cast<size_t>(-1);
+            best = next_used_slot(best);
+        }
+        depth_rebuild();
+    }
+};
+
+}  // namespace test_ns
+
+#endif  // PRICE_LEVELS_H
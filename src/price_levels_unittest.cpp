@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "feed_handler.h"
+#include "price_levels.h"
+
+namespace {
+
+using bid_levels_t = test_ns::price_levels<std::greater<test_ns::price_t>>;
+using ask_levels_t = test_ns::price_levels<std::less<test_ns::price_t>>;
+using level_list_t = std::vector<std::pair<test_ns::price_t, uint64_t>>;
+
+/*
+ *
+ */
+test_ns::book_config_t ladder_config(test_ns::price_t tick, unsigned size) {
+    test_ns::book_config_t config;
+    config.ladder_tick = tick;
+    config.ladder_size = size;
+    return config;
+}
+
+/*
+ * One side of a book with its own orders, removed by id.
+ */
+template <typename levels_t>
+struct test_side_t {
+    struct order_t {
+        test_ns::price_t price;
+        uint64_t quantity;
+    };
+    levels_t levels;
+    test_ns::node_pool<order_t> pool;
+    std::map<uint64_t, test_ns::node_index_t> nodes;
+    explicit test_side_t(const test_ns::book_config_t& config)
+        : levels(config) {}
+    void add(test_ns::price_t price, uint64_t id, uint64_t quantity) {
+        test_ns::node_index_t node = pool.allocate({price, quantity});
+        nodes[id] = node;
+        levels.add(price, node, quantity, &pool);
+    }
+    void remove(uint64_t id) {
+        test_ns::node_index_t node = nodes[id];
+        levels.remove(pool[node].value.price, node,
+                pool[node].value.quantity, &pool);
+        pool.release(node);
+        nodes.erase(id);
+    }
+    /*
+     * Quantities of the orders of the best level, in queue order.
+     */
+    std::vector<uint64_t> get_best_queue() const {
+        std::vector<uint64_t> result;
+        auto node = levels.begin().level().head;
+        for (; node != test_ns::null_node; node = pool[node].next) {
+            result.push_back(pool[node].value.quantity);
+        }
+        return result;
+    }
+};
+
+template <typename levels_t>
+level_list_t get_levels(const test_side_t<levels_t>& side) {
+    auto const & levels = side.levels;
+    level_list_t result;
+    for (auto itr = levels.begin(); itr != levels.end(); ++itr) {
+        result.push_back(std::make_pair(itr.price(), itr.level().volume));
+    }
+    return result;
+}
+
+/*
+ * Volumes by price, the expected content of a side.
+ */
+template <typename better_t>
+struct reference_levels_t {
+    std::map<test_ns::price_t, uint64_t, better_t> levels;
+    void add(test_ns::price_t price, uint64_t quantity) {
+        levels[price] += quantity;
+    }
+    void remove(test_ns::price_t price, uint64_t quantity) {
+        if ((levels[price] -= quantity) == 0) {
+            levels.erase(price);
+        }
+    }
+    level_list_t get() const {
+        return level_list_t(levels.begin(), levels.end());
+    }
+    bool get_cost(uint64_t quantity, test_ns::notional_t* cost,
+            test_ns::price_t* reach) const {
+        uint64_t found = 0;
+        *cost = 0;
+        for (auto const & level : levels) {
+            uint64_t take = std::min(level.second, quantity - found);
+            *cost += static_cast<test_ns::notional_t>(take) * level.first;
+            found += take;
+            if (found == quantity) {
+                *reach = level.first;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/*
+ * The cost from the depth index against the one summed up level by
+ * level.
+ */
+template <typename levels_t, typename reference_t>
+void check_costs(const levels_t& levels, const reference_t& reference) {
+    uint64_t depth = 0;
+    for (auto const & level : reference.levels) {
+        depth += level.second;
+    }
+    for (uint64_t quantity : {depth / 3, depth / 2, depth - 1, depth,
+            depth + 1, static_cast<uint64_t>(1), static_cast<uint64_t>(7)}) {
+        test_ns::notional_t cost = 0, expected = 0;
+        test_ns::price_t reach = 0, expected_reach = 0;
+        bool valid = levels.get_cost(quantity, &cost, &reach);
+        ASSERT_EQ(valid, reference.get_cost(quantity, &expected,
+                &expected_reach)) << quantity;
+        if (valid) {
+            ASSERT_TRUE(cost == expected) << quantity;
+            ASSERT_EQ(reach, expected_reach) << quantity;
+        }
+    }
+}
+
+/*
+ * Random adds and cancels with prices around a drifting mid, some of
+ * them off the tick grid.
+ */
+template <typename levels_t, typename better_t>
+void check_random_walk(test_ns::price_t tick, unsigned size) {
+    test_side_t<levels_t> levels(ladder_config(tick, size));
+    reference_levels_t<better_t> reference;
+    std::mt19937 random(42);
+    struct order_t {
+        uint64_t id;
+        test_ns::price_t price;
+        uint64_t quantity;
+    };
+    std::vector<order_t> orders;
+    test_ns::price_t mid = 1000 * tick;
+    for (uint64_t id = 0; id < 5000; ++id) {
+        mid += (static_cast<int>(random() % 7) - 3) * tick;
+        if (!orders.empty() && random() % 3 == 0) {
+            size_t i = random() % orders.size();
+            levels.remove(orders[i].id);
+            reference.remove(orders[i].price, orders[i].quantity);
+            orders[i] = orders.back();
+            orders.pop_back();
+        } else {
+            test_ns::price_t price = mid +
+                    (static_cast<int>(random() % 41) - 20) * tick;
+            if (random() % 10 == 0) {
+                price += 1;
+            }
+            uint64_t quantity = 1 + random() % 100;
+            levels.add(price, id, quantity);
+            reference.add(price, quantity);
+            orders.push_back(order_t{id, price, quantity});
+        }
+        ASSERT_EQ(get_levels(levels), reference.get()) << "step " << id;
+        ASSERT_EQ(levels.levels.empty(), reference.levels.empty());
+        if (levels.levels.has_depth_index()) {
+            check_costs(levels.levels, reference);
+        }
+    }
+}
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(PriceLevels, TreeOrder) {
+    test_side_t<bid_levels_t> bids(test_ns::book_config_t{});
+    test_side_t<ask_levels_t> asks(test_ns::book_config_t{});
+    ASSERT_TRUE(bids.levels.empty());
+    uint64_t id = 0;
+    for (test_ns::price_t price : {5, 3, 9, 3}) {
+        bids.add(price, ++id, 5);
+        asks.add(price, ++id, 5);
+    }
+    ASSERT_EQ(get_levels(bids), (level_list_t{{9, 5}, {5, 5}, {3, 10}}));
+    ASSERT_EQ(get_levels(asks), (level_list_t{{3, 10}, {5, 5}, {9, 5}}));
+    bids.remove(5);
+    asks.remove(4);
+    ASSERT_EQ(get_levels(bids), (level_list_t{{5, 5}, {3, 10}}));
+    ASSERT_EQ(get_levels(asks), (level_list_t{{3, 5}, {5, 5}, {9, 5}}));
+}
+
+TEST(PriceLevels, LadderBest) {
+    test_side_t<bid_levels_t> bids(ladder_config(10, 16));
+    bids.add(100, 1, 5);
+    bids.add(120, 2, 6);
+    bids.add(110, 3, 7);
+    ASSERT_EQ(bids.levels.begin().price(), 120);
+    bids.remove(2);
+    ASSERT_EQ(bids.levels.begin().price(), 110);
+    bids.remove(3);
+    ASSERT_EQ(bids.levels.begin().price(), 100);
+    bids.remove(1);
+    ASSERT_TRUE(bids.levels.empty());
+    ASSERT_TRUE(bids.levels.begin() == bids.levels.end());
+}
+
+TEST(PriceLevels, LevelQueue) {
+    for (test_ns::price_t tick : {0, 1}) {
+        test_side_t<ask_levels_t> asks(ladder_config(tick, 16));
+        asks.add(7, 1, 5);
+        asks.add(7, 2, 6);
+        asks.add(7, 3, 7);
+        asks.add(7, 4, 8);
+        ASSERT_EQ(asks.levels.begin().level().orders, 4);
+        ASSERT_EQ(asks.levels.begin().level().volume, 26);
+        ASSERT_EQ(asks.get_best_queue(), (std::vector<uint64_t>{5, 6, 7, 8}));
+        asks.remove(2);
+        ASSERT_EQ(asks.get_best_queue(), (std::vector<uint64_t>{5, 7, 8}));
+        asks.remove(1);
+        asks.remove(4);
+        ASSERT_EQ(asks.get_best_queue(), (std::vector<uint64_t>{7}));
+        asks.add(7, 5, 9);
+        ASSERT_EQ(asks.get_best_queue(), (std::vector<uint64_t>{7, 9}));
+        ASSERT_EQ(asks.levels.begin().level().orders, 2);
+        ASSERT_EQ(asks.levels.begin().level().volume, 16);
+    }
+}
+
+TEST(PriceLevels, LadderRecentre) {
+    test_side_t<ask_levels_t> asks(ladder_config(1, 4));
+    asks.add(100, 1, 1);
+    asks.add(101, 2, 2);
+    // far below the window, the touch moves
+    asks.add(50, 3, 1);
+    // above the window, kept aside
+    asks.add(200, 4, 1);
+    asks.add(101, 5, 3);
+    ASSERT_EQ(get_levels(asks),
+            (level_list_t{{50, 1}, {100, 1}, {101, 5}, {200, 1}}));
+    asks.remove(3);
+    ASSERT_EQ(asks.levels.begin().price(), 100);
+    asks.remove(1);
+    // the queue survives the move into the map and back
+    ASSERT_EQ(asks.get_best_queue(), (std::vector<uint64_t>{2, 3}));
+    asks.remove(2);
+    asks.remove(5);
+    ASSERT_EQ(get_levels(asks), (level_list_t{{200, 1}}));
+    asks.add(199, 6, 1);
+    ASSERT_EQ(get_levels(asks), (level_list_t{{199, 1}, {200, 1}}));
+}
+
+TEST(PriceLevels, LadderOffGrid) {
+    test_side_t<bid_levels_t> bids(ladder_config(10, 8));
+    bids.add(100, 1, 1);
+    bids.add(105, 2, 1);
+    bids.add(90, 3, 1);
+    bids.add(111, 4, 1);
+    ASSERT_EQ(get_levels(bids),
+            (level_list_t{{111, 1}, {105, 1}, {100, 1}, {90, 1}}));
+    bids.remove(4);
+    bids.remove(2);
+    ASSERT_EQ(get_levels(bids), (level_list_t{{100, 1}, {90, 1}}));
+}
+
+TEST(PriceLevels, DepthIndex) {
+    test_side_t<ask_levels_t> asks(ladder_config(10, 8));
+    ASSERT_TRUE(asks.levels.has_depth_index());
+    test_ns::notional_t cost;
+    test_ns::price_t reach;
+    ASSERT_FALSE(asks.levels.get_cost(1, &cost, &reach));
+    ASSERT_FALSE(asks.levels.get_cost(0, &cost, &reach));
+    asks.add(100, 1, 5);
+    asks.add(120, 2, 10);
+    // off the grid, between two slots
+    asks.add(115, 3, 1);
+    // below the window
+    asks.add(500, 4, 2);
+    ASSERT_TRUE(asks.levels.get_cost(5, &cost, &reach));
+    ASSERT_TRUE(cost == 500);
+    ASSERT_EQ(reach, 100);
+    ASSERT_TRUE(asks.levels.get_cost(6, &cost, &reach));
+    ASSERT_TRUE(cost == 615);
+    ASSERT_EQ(reach, 115);
+    ASSERT_TRUE(asks.levels.get_cost(8, &cost, &reach));
+    ASSERT_TRUE(cost == 855);
+    ASSERT_TRUE(asks.levels.get_cost(18, &cost, &reach));
+    ASSERT_TRUE(cost == 2815);
+    ASSERT_EQ(reach, 500);
+    ASSERT_FALSE(asks.levels.get_cost(19, &cost, &reach));
+    asks.remove(1);
+    ASSERT_TRUE(asks.levels.get_cost(2, &cost, &reach));
+    ASSERT_TRUE(cost == 235);
+    ASSERT_EQ(reach, 120);
+    ASSERT_TRUE(asks.levels.get_cost(0, &cost, &reach));
+    ASSERT_EQ(reach, 115);
+}
+
+TEST(PriceLevels, NodePoolReuse) {
+    test_ns::node_pool<int> pool;
+    auto a = pool.allocate(1);
+    auto b = pool.allocate(2);
+    ASSERT_EQ(pool.size(), 2);
+    pool.release(a);
+    ASSERT_EQ(pool.size(), 1);
+    auto c = pool.allocate(3);
+    ASSERT_EQ(c, a);
+    ASSERT_EQ(pool[c].value, 3);
+    ASSERT_EQ(pool[b].value, 2);
+    ASSERT_EQ(pool[c].next, test_ns::null_node);
+}
+
+TEST(PriceLevels, LadderSameAsTree) {
+    check_random_walk<bid_levels_t, std::greater<test_ns::price_t>>(0, 0);
+    check_random_walk<bid_levels_t, std::greater<test_ns::price_t>>(5, 16);
+    check_random_walk<ask_levels_t, std::less<test_ns::price_t>>(5, 16);
+    check_random_walk<bid_levels_t, std::greater<test_ns::price_t>>(5, 1024);
+    check_random_walk<ask_levels_t, std::less<test_ns::price_t>>(5, 1024);
+}
+
+TEST(PriceLevels, FeedHandlerSameOutput) {
+    std::vector<std::string> feed = {"SUBSCRIBE BBO,S1",
+            "SUBSCRIBE VWAP,S1,50", "SUBSCRIBE VWAP,S1,500"};
+    std::mt19937 random(7);
+    int mid = 7000;
+    size_t orders = 0;
+    for (int i = 0; i < 3000; ++i) {
+        std::ostringstream ss;
+        mid += static_cast<int>(random() % 5) - 2;
+        if (orders != 0 && random() % 3 == 0) {
+            size_t id = random() % orders;
+            if (random() % 2 == 0) {
+                ss << "ORDER CANCEL," << id;
+            } else {
+                ss << "ORDER MODIFY," << id << ',' << 1 + random() % 50
+                   << ',' << (mid + static_cast<int>(random() % 11)) / 100.;
+            }
+        } else {
+            bool buy = random() % 2 == 0;
+            int price = buy ? mid - static_cast<int>(random() % 30)
+                            : mid + 1 + static_cast<int>(random() % 30);
+            ss << "ORDER ADD," << orders++ << ",S1,"
+               << (buy ? "Buy" : "Sell") << ',' << 1 + random() % 50 << ','
+               << price / 100.;
+            if (random() % 20 == 0) {
+                ss << '5';
+            }
+        }
+        feed.push_back(ss.str());
+        if (i % 100 == 0) {
+            feed.push_back("PRINT,S1");
+            feed.push_back("PRINT_FULL,S1");
+        }
+    }
+
+    std::vector<std::string> tree_output, ladder_output;
+    test_ns::feed_handler tree_handler("",
+            [&tree_output](const std::string& s) {
+                tree_output.push_back(s);
+            },
+            [](const std::string&, const std::string&) {});
+    test_ns::feed_handler ladder_handler("",
+            [&ladder_output](const std::string& s) {
+                ladder_output.push_back(s);
+            },
+            [](const std::string&, const std::string&) {},
+            ladder_config(test_ns::price_scale / 100, 64));
+    for (auto const & line : feed) {
+        tree_handler.process_command(line);
+        ladder_handler.process_command(line);
+    }
+    ASSERT_FALSE(tree_output.empty());
+    ASSERT_EQ(tree_output, ladder_output);
+}
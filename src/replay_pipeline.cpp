@@ -0,0 +1,209 @@
+#include "replay_pipeline.h"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <string>
+#include <thread>
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+/*
+ * The next slot to read, nullptr once the ring is drained. Waiting for
+ * one counts as the stage being starved.
+ */
+template <typename value_t>
+value_t* wait_pop(test_ns::spsc_ring<value_t>* ring,
+        test_ns::pipeline_stage_stats_t* stats) {
+    value_t* slot = ring->begin_pop();
+    if (slot == nullptr && !ring->is_drained()) {
+        ++stats->starved;
+        auto start = std::chrono::steady_clock::now();
+        while ((slot = ring->begin_pop()) == nullptr && !ring->is_drained()) {
+            std::this_thread::yield();
+        }
+        stats->waiting_seconds += seconds_since(start);
+    }
+    return slot;
+}
+
+/*
+ * The next slot to fill. Waiting for one counts as the stage being
+ * blocked.
+ */
+template <typename value_t>
+value_t* wait_push(test_ns::spsc_ring<value_t>* ring,
+        test_ns::pipeline_stage_stats_t* stats) {
+    value_t* slot = ring->begin_push();
+    if (slot == nullptr) {
+        ++stats->blocked;
+        auto start = std::chrono::steady_clock::now();
+        while ((slot = ring->begin_push()) == nullptr) {
+            std::this_thread::yield();
+        }
+        stats->waiting_seconds += seconds_since(start);
+    }
+    return slot;
+}
+
+}  // namespace
+
+/*
+ * batch_size lines are passed at a time, each ring holds ring_size
+ * batches.
+ */
+test_ns::
+replay_pipeline::replay_pipeline(size_t a_batch_size, size_t ring_size)
+    : batch_size(a_batch_size == 0 ? 1 : a_batch_size),
+      line_ring(ring_size), command_ring(ring_size) {
+    std::memset(stats, 0, sizeof(stats));
+}
+
+/*
+ * Replays every line of reader. A pipeline replays a single feed.
+ */
+void test_ns::
+replay_pipeline::run(line_reader* reader, feed_handler* handler) {
+    symbol_t selected_symbol = handler->get_selected_symbol();
+    std::thread reader_thread(&replay_pipeline::read, this, reader);
+    std::thread parser_thread(&replay_pipeline::parse, this,
+            std::cref(selected_symbol));
+    apply(handler);
+    reader_thread.join();
+    parser_thread.join();
+}
+
+/*
+ *
+ */
+const test_ns::pipeline_stage_stats_t& test_ns::
+replay_pipeline::get_stats(pipeline_stage_t stage) const {
+    return stats[static_cast<unsigned>(stage)];
+}
+
+/*
+ * A line per stage, busy is the time the stage did not wait.
+ */
+void test_ns::
+replay_pipeline::print_stats(std::ostream& out) const {
+    for (unsigned i = 0; i != pipeline_stages; ++i) {
+        auto const & stage = stats[i];
+        double busy = stage.running_seconds <= 0 ? 0 : 100 *
+                (stage.running_seconds - stage.waiting_seconds) /
+                stage.running_seconds;
+        out << std::left << std::setw(8)
+            << get_name(static_cast<pipeline_stage_t>(i)) << std::right
+            << " batches " << stage.batches << ", lines " << stage.lines
+            << ", starved " << stage.starved << ", blocked "
+            << stage.blocked << ", busy " << std::fixed
+            << std::setprecision(1) << busy << "% of "
+            << std::setprecision(3) << stage.running_seconds << " s"
+            << std::endl;
+    }
+}
+
+/*
+ *
+ */
+const char* test_ns::
+replay_pipeline::get_name(pipeline_stage_t stage) {
+    switch (stage) {
+    case pipeline_stage_t::reader:
+        return "reader";
+    case pipeline_stage_t::parser:
+        return "parser";
+    case pipeline_stage_t::applier:
+        return "applier";
+    }
+    return "";
+}
+
+/*
+ * Lines of a file which is not mapped are copied into the batch. Their
+ * offsets are kept until the batch is full, as the text may move while
+ * it grows.
+ */
+void test_ns::
+replay_pipeline::read(line_reader* reader) {
+    auto & stage = stats[static_cast<unsigned>(pipeline_stage_t::reader)];
+    auto start = std::chrono::steady_clock::now();
+    bool mapped = reader->is_mapped();
+    std::vector<size_t> offsets;
+    str_view_t line;
+    for (bool more = true; more; ) {
+        line_batch_t* batch = wait_push(&line_ring, &stage);
+        batch->text.clear();
+        batch->lines.clear();
+        offsets.clear();
+        while (batch->lines.size() < batch_size &&
+                (more = reader->next_line(&line))) {
+            if (!mapped) {
+                offsets.push_back(batch->text.size());
+                batch->text.insert(batch->text.end(), line.begin(),
+                        line.end());
+            }
+            batch->lines.push_back(line);
+        }
+        if (batch->lines.empty()) {
+            break;
+        }
+        if (!mapped) {
+            for (size_t i = 0; i != offsets.size(); ++i) {
+                batch->lines[i].data = batch->text.data() + offsets[i];
+            }
+        }
+        ++stage.batches;
+        stage.lines += batch->lines.size();
+        line_ring.end_push();
+    }
+    line_ring.close();
+    stage.running_seconds = seconds_since(start);
+}
+
+/*
+ *
+ */
+void test_ns::
+replay_pipeline::parse(const symbol_t& selected_symbol) {
+    auto & stage = stats[static_cast<unsigned>(pipeline_stage_t::parser)];
+    auto start = std::chrono::steady_clock::now();
+    while (line_batch_t* in = wait_pop(&line_ring, &stage)) {
+        command_batch_t* out = wait_push(&command_ring, &stage);
+        out->commands.resize(in->lines.size());
+        for (size_t i = 0; i != in->lines.size(); ++i) {
+            feed_handler::parse_line(in->lines[i], selected_symbol,
+                    &out->commands[i]);
+        }
+        out->text.swap(in->text);
+        ++stage.batches;
+        stage.lines += in->lines.size();
+        line_ring.end_pop();
+        command_ring.end_push();
+    }
+    command_ring.close();
+    stage.running_seconds = seconds_since(start);
+}
+
+/*
+ *
+ */
+void test_ns::
+replay_pipeline::apply(feed_handler* handler) {
+    auto & stage = stats[static_cast<unsigned>(pipeline_stage_t::applier)];
+    auto start = std::chrono::steady_clock::now();
+    while (command_batch_t* batch = wait_pop(&command_ring, &stage)) {
+        for (auto const & parsed : batch->commands) {
+            handler->process_parsed(parsed);
+        }
+        ++stage.batches;
+        stage.lines += batch->commands.size();
+        command_ring.end_pop();
+    }
+    stage.running_seconds = seconds_since(start);
+}
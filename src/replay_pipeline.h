@@ -0,0 +1,91 @@
+#ifndef REPLAY_PIPELINE_H
+#define REPLAY_PIPELINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "feed_handler.h"
+#include "line_reader.h"
+#include "spsc_ring.h"
+#include "str_view.h"
+
+namespace test_ns {
+
+enum class pipeline_stage_t {
+    reader,
+    parser,
+    applier
+};
+
+const unsigned pipeline_stages = 3;
+
+/*
+ * What a stage did. A stage is starved when its input ring is empty and
+ * blocked when its output ring is full; waiting_seconds is the time it
+ * spent in either state out of running_seconds.
+ */
+struct pipeline_stage_stats_t {
+    uint64_t batches;
+    uint64_t lines;
+    uint64_t starved;
+    uint64_t blocked;
+    double running_seconds;
+    double waiting_seconds;
+};
+
+/*
+ * Replays a text feed in three stages, each on a thread of its own:
+ * the reader splits the input into batches of lines, the parser decodes
+ * them with feed_handler::parse_command() and the applier, the thread
+ * calling run(), applies the commands to the feed_handler. The stages
+ * are connected by spsc_rings of batches.
+ *
+ * The output is the one of feed_handler::process_command() on every
+ * line. Lines which are not valid commands reach the applier as text and
+ * are processed as such, so they are reported as usual.
+ */
+class replay_pipeline {
+ public:
+    explicit replay_pipeline(size_t batch_size = 4096,
+            size_t ring_size = 8);
+    replay_pipeline(const replay_pipeline&) = delete;
+    replay_pipeline& operator=(const replay_pipeline&) = delete;
+
+    void run(line_reader*, feed_handler*);
+    const pipeline_stage_stats_t& get_stats(pipeline_stage_t) const;
+    void print_stats(std::ostream&) const;
+    static const char* get_name(pipeline_stage_t);
+
+ private:
+    /*
+     * Lines are views into the mapped file, or into text if the input
+     * is not mapped.
+     */
+    struct line_batch_t {
+        std::vector<char> text;
+        std::vector<str_view_t> lines;
+    };
+    /*
+     * text is taken over from the line batch the commands were parsed
+     * from, a vector keeps its data when swapped.
+     */
+    struct command_batch_t {
+        std::vector<char> text;
+        std::vector<parsed_line_t> commands;
+    };
+
+    size_t batch_size;
+    spsc_ring<line_batch_t> line_ring;
+    spsc_ring<command_batch_t> command_ring;
+    pipeline_stage_stats_t stats[pipeline_stages];
+
+    void read(line_reader*);
+    void parse(const symbol_t& selected_symbol);
+    void apply(feed_handler*);
+};
+
+}  // namespace test_ns
+
+#endif  // REPLAY_PIPELINE_H
@@ -0,0 +1,126 @@
+#include <unistd.h>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "feed_handler.h"
+#include "line_reader.h"
+#include "replay_pipeline.h"
+#include "unittest_util.h"
+
+namespace {
+
+using test_ns::unittest::make_err_callback;
+using test_ns::unittest::random_feed;
+using test_ns::unittest::replay;
+using test_ns::unittest::replay_result_t;
+using test_ns::unittest::temp_file_t;
+
+/*
+ *
+ */
+replay_result_t replay_pipelined(test_ns::line_reader* reader,
+        const std::string& symbol, test_ns::replay_pipeline* pipeline) {
+    replay_result_t result;
+    test_ns::string_sink output(&result.output);
+    test_ns::feed_handler handler(symbol, &output,
+            make_err_callback(&result));
+    pipeline->run(reader, &handler);
+    output.flush();
+    return result;
+}
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(ReplayPipeline, EmptyFile) {
+    temp_file_t file("");
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    test_ns::replay_pipeline pipeline;
+    replay_result_t result = replay_pipelined(&reader, "", &pipeline);
+    ASSERT_TRUE(result.output.empty());
+    for (unsigned i = 0; i != test_ns::pipeline_stages; ++i) {
+        auto stage = static_cast<test_ns::pipeline_stage_t>(i);
+        ASSERT_EQ(pipeline.get_stats(stage).batches, 0);
+    }
+}
+
+/*
+ * The same output and errors as a replay line by line, whatever the
+ * batch and ring sizes.
+ */
+TEST(ReplayPipeline, SameAsProcessCommand) {
+    temp_file_t file(random_feed(1, 20000));
+    for (const char* symbol : {"", "S2"}) {
+        replay_result_t expected = replay(file.name, symbol);
+        ASSERT_FALSE(expected.output.empty());
+        ASSERT_FALSE(expected.errors.empty());
+        for (size_t batch_size : {1, 7, 4096}) {
+            for (size_t ring_size : {1, 4}) {
+                test_ns::line_reader reader;
+                ASSERT_TRUE(reader.open(file.name));
+                test_ns::replay_pipeline pipeline(batch_size, ring_size);
+                replay_result_t result =
+                        replay_pipelined(&reader, symbol, &pipeline);
+                ASSERT_EQ(result.output, expected.output);
+                ASSERT_EQ(result.errors, expected.errors);
+            }
+        }
+    }
+}
+
+/*
+ * Lines read through a pipe are copied into the batches.
+ */
+TEST(ReplayPipeline, Pipe) {
+    std::string feed = random_feed(2, 5000);
+    temp_file_t file(feed);
+    replay_result_t expected = replay(file.name, "");
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    std::thread writer([&]() {
+        size_t written = 0;
+        while (written < feed.size()) {
+            ssize_t n = write(fds[1], feed.data() + written,
+                    feed.size() - written);
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        close(fds[1]);
+    });
+    test_ns::line_reader reader;
+    reader.open_fd(fds[0]);
+    test_ns::replay_pipeline pipeline(100, 2);
+    replay_result_t result = replay_pipelined(&reader, "", &pipeline);
+    writer.join();
+    close(fds[0]);
+    ASSERT_EQ(result.output, expected.output);
+    ASSERT_EQ(result.errors, expected.errors);
+}
+
+/*
+ *
+ */
+TEST(ReplayPipeline, Stats) {
+    temp_file_t file(random_feed(3, 1000));
+    test_ns::line_reader reader;
+    ASSERT_TRUE(reader.open(file.name));
+    test_ns::replay_pipeline pipeline(300, 2);
+    replay_pipelined(&reader, "", &pipeline);
+    for (unsigned i = 0; i != test_ns::pipeline_stages; ++i) {
+        auto stage = static_cast<test_ns::pipeline_stage_t>(i);
+        ASSERT_EQ(pipeline.get_stats(stage).batches, 4);
+        ASSERT_EQ(pipeline.get_stats(stage).lines, 1000);
+        ASSERT_LE(pipeline.get_stats(stage).waiting_seconds,
+                pipeline.get_stats(stage).running_seconds);
+    }
+    std::ostringstream out;
+    pipeline.print_stats(out);
+    ASSERT_NE(out.str().find("applier"), std::string::npos);
+}
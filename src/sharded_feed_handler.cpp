@@ -0,0 +1,308 @@
+#include "sharded_feed_handler.h"
+
+/*
+ * The workers start waiting for batches at once.
+ */
+test_ns::
+sharded_feed_handler::sharded_feed_handler(const symbol_t& a_selected_symbol,
+        unsigned a_shards, output_sink* an_output,
+        err_callback_t&& an_err_callback, const book_config_t& config)
+    : selected_symbol(a_selected_symbol), output(an_output),
+      err_callback(std::move(an_err_callback)),
+      shards(a_shards == 0 ? 1 : a_shards), batches(batch_slots),
+      dispatched(0), merged(0), stopping(false), subs_changed(false) {
+    for (auto & batch : batches) {
+        batch.shard_batches.resize(shards);
+        batch.pending = 0;
+    }
+    for (unsigned i = 0; i != shards; ++i) {
+        std::unique_ptr<worker_t> worker(new worker_t());
+        worker_t* a_worker = worker.get();
+        worker->output.reset(new string_sink(&worker->output_text));
+        worker->errors = nullptr;
+        err_callback_t worker_err_callback;
+        if (err_callback) {
+            worker_err_callback = [a_worker](const std::string& line,
+                    const std::string& err) {
+                a_worker->errors->emplace_back(line, err);
+            };
+        }
+        worker->handler.reset(new feed_handler(selected_symbol,
+                worker->output.get(), std::move(worker_err_callback),
+                config));
+        workers.push_back(std::move(worker));
+    }
+    for (unsigned i = 0; i != shards; ++i) {
+        workers[i]->thread = std::thread(&sharded_feed_handler::run_worker,
+                this, i);
+    }
+}
+
+/*
+ *
+ */
+test_ns::
+sharded_feed_handler::~sharded_feed_handler() {
+    finish();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto & worker : workers) {
+        worker->thread.join();
+    }
+}
+
+/*
+ *
+ */
+void test_ns::
+sharded_feed_handler::process_command(const str_view_t& line) {
+    line_commas_t commas;
+    delimiter_scanner::find_commas(line, &commas);
+    process_command(line, commas);
+}
+
+/*
+ * commas are the ones of line, as delimiter_scanner finds them.
+ */
+void test_ns::
+sharded_feed_handler::process_command(const str_view_t& line,
+        const line_commas_t& commas) {
+    auto & batch = batches[dispatched % batch_slots];
+    uint32_t shard = route(line, commas);
+    batch.shard_batches[shard].lines.push_back(batch.lines.size());
+    batch.lines.push_back(std::make_pair(batch.text.size(), line.size));
+    batch.text.append(line.data, line.size);
+    batch.shards.push_back(shard);
+    if (batch.lines.size() == batch_size) {
+        dispatch();
+    }
+}
+
+/*
+ *
+ */
+void test_ns::
+sharded_feed_handler::finish() {
+    if (!batches[dispatched % batch_slots].lines.empty()) {
+        dispatch();
+    }
+    while (merged != dispatched) {
+        merge_oldest();
+    }
+}
+
+/*
+ * The shard of a command. A duplicate order id goes to the shard that
+ * has the id, an unknown one to the first shard, so that the
+ * feed_handler of the shard reports them as a single one would.
+ */
+uint32_t test_ns::
+sharded_feed_handler::route(const str_view_t& line,
+        const line_commas_t& commas) {
+    command_args_t command;
+    if (feed_handler::parse_command(line, commas, selected_symbol,
+            &command) != nullptr) {
+        return 0;
+    }
+    switch (command.command) {
+    case command_t::none:
+        return 0;
+    case command_t::order_add: {
+        uint32_t shard = symbols.intern(command.symbol) % shards;
+        return *order_shards.insert(command.id, shard).first;
+    }
+    case command_t::order_modify: {
+        auto shard = order_shards.find(command.id);
+        return shard == nullptr ? 0 : *shard;
+    }
+    case command_t::order_cancel: {
+        auto shard = order_shards.find(command.id);
+        if (shard == nullptr) {
+            return 0;
+        }
+        uint32_t found = *shard;
+        order_shards.erase(command.id);
+        return found;
+    }
+    default:
+        return symbols.intern(command.symbol) % shards;
+    }
+}
+
+/*
+ * Hands the batch being filled to the workers. The oldest batch is
+ * merged first if every slot is taken, so the next one is free.
+ */
+void test_ns::
+sharded_feed_handler::dispatch() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        batches[dispatched % batch_slots].pending = shards;
+        ++dispatched;
+    }
+    work_ready.notify_all();
+    if (dispatched - merged == batch_slots) {
+        merge_oldest();
+    }
+}
+
+/*
+ * Waits for the workers to finish the oldest batch and writes its
+ * output in the order of its lines.
+ */
+void test_ns::
+sharded_feed_handler::merge_oldest() {
+    auto & batch = batches[merged % batch_slots];
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        work_done.wait(guard, [&batch] { return batch.pending == 0; });
+    }
+    std::vector<size_t> next(shards, 0);
+    std::vector<size_t> errors_begin(shards, 0);
+    std::vector<size_t> text_begin(shards, 0);
+    for (uint32_t shard : batch.shards) {
+        auto const & shard_batch = batch.shard_batches[shard];
+        merge_result(shard_batch, shard_batch.results[next[shard]++],
+                &errors_begin[shard], &text_begin[shard]);
+    }
+    batch.text.clear();
+    batch.lines.clear();
+    batch.shards.clear();
+    for (auto & shard_batch : batch.shard_batches) {
+        shard_batch.clear();
+    }
+    ++merged;
+}
+
+/*
+ * Errors first, then what the command printed itself and the
+ * subscriptions.
+ */
+void test_ns::
+sharded_feed_handler::merge_result(const shard_batch_t& shard_batch,
+        const command_result_t& result, size_t* errors_begin,
+        size_t* text_begin) {
+    for (; *errors_begin != result.errors_end; ++*errors_begin) {
+        auto const & error = shard_batch.errors[*errors_begin];
+        err_callback(error.first, error.second);
+    }
+    const char* text = shard_batch.text.data();
+    output->write_lines(str_view_t(text + *text_begin,
+            result.output_end - *text_begin));
+    if (result.has_symbol) {
+        str_view_t bbo(text + result.output_end,
+                result.bbo_end - result.output_end);
+        str_view_t vwaps(text + result.bbo_end,
+                result.vwaps_end - result.bbo_end);
+        if (bbo.empty() && vwaps.empty()) {
+            subs_changed |= subs_lines.erase(result.symbol) != 0;
+        } else {
+            auto & lines = subs_lines[result.symbol];
+            if (str_view_t(lines.bbo) != bbo ||
+                    str_view_t(lines.vwaps) != vwaps) {
+                lines.bbo.assign(bbo.data, bbo.size);
+                lines.vwaps.assign(vwaps.data, vwaps.size);
+                subs_changed = true;
+            }
+        }
+    }
+    *text_begin = result.vwaps_end;
+    if (result.print_subs) {
+        print_subs();
+    }
+}
+
+/*
+ * BBO lines by symbol name, then VWAP lines. The two blocks are joined
+ * again only after a change.
+ */
+void test_ns::
+sharded_feed_handler::print_subs() {
+    if (subs_changed) {
+        bbo_block.clear();
+        vwaps_block.clear();
+        for (auto const & symbol_and_lines : subs_lines) {
+            bbo_block += symbol_and_lines.second.bbo;
+            vwaps_block += symbol_and_lines.second.vwaps;
+        }
+        subs_changed = false;
+    }
+    output->write_lines(bbo_block);
+    output->write_lines(vwaps_block);
+}
+
+/*
+ * Takes every batch in turn and processes the lines of its shard.
+ */
+void test_ns::
+sharded_feed_handler::run_worker(unsigned shard) {
+    worker_t* worker = workers[shard].get();
+    for (uint64_t next = 0; ; ++next) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            work_ready.wait(guard, [this, next] {
+                return stopping || dispatched > next;
+            });
+            if (dispatched <= next) {
+                return;
+            }
+        }
+        auto & batch = batches[next % batch_slots];
+        process_shard_batch(worker, batch, &batch.shard_batches[shard]);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            --batch.pending;
+        }
+        work_done.notify_all();
+    }
+}
+
+/*
+ * After a command that may change the subscription lines of a symbol,
+ * these lines are printed too.
+ */
+void test_ns::
+sharded_feed_handler::process_shard_batch(worker_t* worker,
+        const batch_t& batch, shard_batch_t* shard_batch) {
+    auto & handler = *worker->handler;
+    auto & sink = *worker->output;
+    auto & text = worker->output_text;
+    worker->errors = &shard_batch->errors;
+    for (uint32_t i : shard_batch->lines) {
+        command_result_t result;
+        str_view_t symbol;
+        result.print_subs = handler.apply_line(batch.get_line(i), &symbol);
+        sink.flush();
+        result.errors_end = shard_batch->errors.size();
+        result.output_end = text.size();
+        result.has_symbol = !symbol.empty();
+        if (result.has_symbol) {
+            result.symbol.assign(symbol.data, symbol.size);
+            handler.print_symbol_bbo(symbol, &sink);
+            sink.flush();
+        }
+        result.bbo_end = text.size();
+        if (result.has_symbol) {
+            handler.print_symbol_vwaps(symbol, &sink);
+            sink.flush();
+        }
+        result.vwaps_end = text.size();
+        shard_batch->results.push_back(std::move(result));
+    }
+    shard_batch->text.swap(text);
+    text.clear();
+}
+
+/*
+ *
+ */
+void test_ns::
+sharded_feed_handler::shard_batch_t::clear() {
+    lines.clear();
+    results.clear();
+    text.clear();
+    errors.clear();
+}
@@ -0,0 +1,143 @@
+#ifndef SHARDED_FEED_HANDLER_H
+#define SHARDED_FEED_HANDLER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "delimiter_scanner.h"
+#include "feed_handler.h"
+#include "id_map.h"
+#include "output_sink.h"
+#include "str_view.h"
+#include "symbol_table.h"
+
+namespace test_ns {
+
+/*
+ * Replays a feed on several threads. Symbols are dealt out to shards as
+ * they are first seen. Every shard has a worker thread with a
+ * feed_handler of its own. An order command goes to the shard of its
+ * symbol; a modify or a cancel goes to the shard its order id was added
+ * to. Lines that are not valid commands go to the first shard, which
+ * reports them.
+ *
+ * After each command a worker prints only the subscription lines of the
+ * symbol the command changed. The thread calling process_command() keeps
+ * the last lines of every subscribed symbol. It merges the output of
+ * the workers back in the order of the commands, so the output is the
+ * one of a single feed_handler.
+ *
+ * Lines are copied and passed on in batches. Output is written by the
+ * thread calling process_command() and finish() as batches complete.
+ */
+class sharded_feed_handler {
+ public:
+    sharded_feed_handler(const symbol_t& selected_symbol, unsigned shards,
+            output_sink*, err_callback_t&&,
+            const book_config_t& config = book_config_t());
+    ~sharded_feed_handler();
+    sharded_feed_handler(const sharded_feed_handler&) = delete;
+    sharded_feed_handler& operator=(const sharded_feed_handler&) = delete;
+
+    void process_command(const str_view_t&);
+    void process_command(const str_view_t& line, const line_commas_t&);
+    /*
+     * Waits for the commands passed so far and writes their output.
+     */
+    void finish();
+
+ private:
+    static const size_t batch_size = 4096;
+    static const size_t batch_slots = 4;
+    using errors_t = std::vector<std::pair<std::string, std::string>>;
+    /*
+     * What a command printed, as ends of ranges of shard_batch_t::text
+     * and errors. If symbol is set, the BBO line and the VWAP lines of
+     * the symbol follow its output.
+     */
+    struct command_result_t {
+        size_t errors_end;
+        size_t output_end;
+        size_t bbo_end;
+        size_t vwaps_end;
+        bool print_subs;
+        bool has_symbol;
+        std::string symbol;
+    };
+    /*
+     * The lines of a batch that go to one shard and their results.
+     */
+    struct shard_batch_t {
+        std::vector<uint32_t> lines;
+        std::vector<command_result_t> results;
+        std::string text;
+        errors_t errors;
+        void clear();
+    };
+    struct batch_t {
+        std::string text;
+        std::vector<std::pair<size_t, size_t>> lines;
+        std::vector<uint32_t> shards;
+        std::vector<shard_batch_t> shard_batches;
+        unsigned pending;
+        str_view_t get_line(size_t i) const {
+            return str_view_t(text.data() + lines[i].first,
+                    lines[i].second);
+        }
+    };
+    struct worker_t {
+        std::unique_ptr<feed_handler> handler;
+        std::string output_text;
+        std::unique_ptr<string_sink> output;
+        errors_t* errors;
+        std::thread thread;
+    };
+    /*
+     * The last lines printed for the subscriptions of a symbol.
+     */
+    struct symbol_lines_t {
+        std::string bbo;
+        std::string vwaps;
+    };
+
+    symbol_t selected_symbol;
+    output_sink* output;
+    err_callback_t err_callback;
+    unsigned shards;
+    // symbols and live order ids as the dispatcher sees them
+    symbol_table symbols;
+    id_map<uint32_t> order_shards;
+    std::vector<std::unique_ptr<worker_t>> workers;
+    std::vector<batch_t> batches;
+    uint64_t dispatched;
+    uint64_t merged;
+    std::mutex lock;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    bool stopping;
+    std::map<std::string, symbol_lines_t> subs_lines;
+    bool subs_changed;
+    std::string bbo_block;
+    std::string vwaps_block;
+
+    uint32_t route(const str_view_t& line, const line_commas_t&);
+    void dispatch();
+    void merge_oldest();
+    void merge_result(const shard_batch_t&, const command_result_t&,
+            size_t* errors_begin, size_t* text_begin);
+    void print_subs();
+    void run_worker(unsigned shard);
+    void process_shard_batch(worker_t*, const batch_t&, shard_batch_t*);
+};
+
+}  // namespace test_ns
+
+#endif  // SHARDED_FEED_HANDLER_H
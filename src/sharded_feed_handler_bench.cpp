@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "feed_handler.h"
+#include "sharded_feed_handler.h"
+
+/*
+ * Replays one feed on a feed_handler and on a sharded_feed_handler with
+ * 1 worker and up, to show how the replay scales with the workers. The
+ * feed has many symbols with a BBO and a VWAP subscription each.
+ */
+namespace {
+
+/*
+ * Counts the bytes written and drops them.
+ */
+class null_sink : public test_ns::output_sink {
+ public:
+    null_sink() : output_sink(1 << 16), bytes(0) {}
+    ~null_sink() { flush(); }
+    size_t get_bytes() const { return bytes; }
+
+ protected:
+    void write_out(const char*, size_t size) override { bytes += size; }
+
+ private:
+    size_t bytes;
+};
+
+double elapsed_s(std::chrono::steady_clock::time_point start) {
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+std::vector<std::string> make_feed(unsigned symbols, size_t size) {
+    std::mt19937_64 generator(7);
+    std::vector<std::string> lines;
+    for (unsigned i = 0; i < symbols; ++i) {
+        lines.push_back("SUBSCRIBE BBO,S" + std::to_string(i));
+        lines.push_back("SUBSCRIBE VWAP,S" + std::to_string(i) + ",500");
+    }
+    std::vector<uint64_t> live;
+    for (uint64_t id = 0; lines.size() < size; ++id) {
+        if (live.size() > 1000 && generator() % 2 == 0) {
+            size_t i = generator() % live.size();
+            lines.push_back("ORDER CANCEL," + std::to_string(live[i]));
+            live[i] = live.back();
+            live.pop_back();
+        } else {
+            lines.push_back("ORDER ADD," + std::to_string(id) + ",S" +
+                    std::to_string(generator() % symbols) + "," +
+                    (generator() % 2 == 0 ? "Buy" : "Sell") + "," +
+                    std::to_string(1 + generator() % 100) + "," +
+                    std::to_string(90 + generator() % 20) + "." +
+                    std::to_string(generator() % 100));
+            live.push_back(id);
+        }
+    }
+    return lines;
+}
+
+template <typename handler_t>
+void replay(handler_t* handler, const std::vector<std::string>& lines) {
+    for (auto const & line : lines) {
+        handler->process_command(line);
+    }
+}
+
+void report(const char* name, unsigned workers, double seconds,
+        double base_seconds, size_t lines, size_t bytes) {
+    std::printf("%-22s %2u %8.3f s %10.0f lines/s  x%.2f  (%zu bytes)\n",
+            name, workers, seconds, lines / seconds, base_seconds / seconds,
+            bytes);
+}
+
+}  // namespace
+
+int main() {
+    const unsigned symbols = 16;
+    auto lines = make_feed(symbols, 400000);
+    unsigned max_workers = std::max(4u, std::thread::hardware_concurrency());
+
+    null_sink base_output;
+    auto start = std::chrono::steady_clock::now();
+    {
+        test_ns::feed_handler handler("", &base_output,
+                test_ns::err_callback_t());
+        replay(&handler, lines);
+    }
+    base_output.flush();
+    double base_seconds = elapsed_s(start);
+    report("feed_handler", 1, base_seconds, base_seconds, lines.size(),
+            base_output.get_bytes());
+
+    for (unsigned workers = 1; workers <= max_workers; ++workers) {
+        null_sink output;
+        start = std::chrono::steady_clock::now();
+        {
+            test_ns::sharded_feed_handler handler("", workers, &output,
+                    test_ns::err_callback_t());
+            replay(&handler, lines);
+            handler.finish();
+        }
+        output.flush();
+        report("sharded_feed_handler", workers, elapsed_s(start),
+                base_seconds, lines.size(), output.get_bytes());
+    }
+}
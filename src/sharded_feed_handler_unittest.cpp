@@ -0,0 +1,147 @@
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "feed_handler.h"
+#include "sharded_feed_handler.h"
+#include "unittest_util.h"
+
+namespace {
+
+using lines_t = std::vector<std::string>;
+using test_ns::unittest::make_err_callback;
+using test_ns::unittest::random_lines;
+using test_ns::unittest::replay_result_t;
+
+/*
+ * A replay on a sharded_feed_handler, or on a feed_handler if shards is
+ * 0.
+ */
+replay_result_t replay(const lines_t& lines, const std::string& symbol,
+        unsigned shards, bool report_errors = true) {
+    replay_result_t result;
+    test_ns::err_callback_t err_callback;
+    if (report_errors) {
+        err_callback = make_err_callback(&result);
+    }
+    test_ns::string_sink output(&result.output);
+    if (shards == 0) {
+        test_ns::feed_handler handler(symbol, &output,
+                std::move(err_callback));
+        for (auto const & line : lines) {
+            handler.process_command(line);
+        }
+    } else {
+        test_ns::sharded_feed_handler handler(symbol, shards, &output,
+                std::move(err_callback));
+        for (auto const & line : lines) {
+            handler.process_command(line);
+        }
+        handler.finish();
+    }
+    output.flush();
+    return result;
+}
+
+/*
+ *
+ */
+void check_random_lines(unsigned seed, size_t size,
+        const std::string& symbol) {
+    lines_t lines = random_lines(seed, size);
+    replay_result_t expected = replay(lines, symbol, 0);
+    ASSERT_FALSE(expected.output.empty());
+    ASSERT_FALSE(expected.errors.empty());
+    for (unsigned shards = 1; shards <= 4; ++shards) {
+        replay_result_t result = replay(lines, symbol, shards);
+        ASSERT_EQ(result.output, expected.output) << shards;
+        ASSERT_EQ(result.errors, expected.errors) << shards;
+    }
+}
+
+}  // namespace
+
+/*
+ *
+ */
+TEST(ShardedFeedHandler, Empty) {
+    replay_result_t result = replay(lines_t(), "", 2);
+    ASSERT_TRUE(result.output.empty());
+    ASSERT_TRUE(result.errors.empty());
+}
+
+/*
+ * The subscription lines of a symbol on another shard are printed after
+ * a command of this shard.
+ */
+TEST(ShardedFeedHandler, SubsOfOtherShards) {
+    lines_t lines = {"SUBSCRIBE BBO,S1", "SUBSCRIBE BBO,S2",
+        "ORDER ADD,1,S1,Buy,10,72.82", "ORDER ADD,2,S2,Sell,5,72.9",
+        "ORDER MODIFY,1,20,72.83", "UNSUBSCRIBE BBO,S1",
+        "ORDER CANCEL,2"};
+    replay_result_t expected = replay(lines, "", 0);
+    replay_result_t result = replay(lines, "", 2);
+    ASSERT_EQ(result.output, expected.output);
+    ASSERT_EQ(result.errors, expected.errors);
+}
+
+/*
+ * A duplicate id is reported whatever symbol it is added for, unknown
+ * ids are reported once gone.
+ */
+TEST(ShardedFeedHandler, OrderIdErrors) {
+    lines_t lines = {"ORDER ADD,1,S1,Buy,10,72.82",
+        "ORDER ADD,1,S2,Buy,10,72.82", "ORDER CANCEL,1",
+        "ORDER CANCEL,1", "ORDER MODIFY,1,10,72.82",
+        "ORDER ADD,1,S2,Buy,10,72.82", "PRINT,S2"};
+    replay_result_t expected = replay(lines, "", 0);
+    ASSERT_EQ(expected.errors.size(), 3);
+    replay_result_t result = replay(lines, "", 3);
+    ASSERT_EQ(result.output, expected.output);
+    ASSERT_EQ(result.errors, expected.errors);
+}
+
+/*
+ * More lines than fit in all batches at once.
+ */
+TEST(ShardedFeedHandler, RandomFeed) {
+    check_random_lines(1, 20000, "");
+    check_random_lines(2, 3000, "");
+}
+
+/*
+ *
+ */
+TEST(ShardedFeedHandler, SelectedSymbol) {
+    check_random_lines(3, 20000, "S2");
+}
+
+/*
+ *
+ */
+TEST(ShardedFeedHandler, NoErrorCallback) {
+    lines_t lines = random_lines(4, 10000);
+    replay_result_t expected = replay(lines, "", 0, false);
+    replay_result_t result = replay(lines, "", 3, false);
+    ASSERT_EQ(result.output, expected.output);
+}
+
+/*
+ * finish() writes the output so far, lines can follow.
+ */
+TEST(ShardedFeedHandler, Finish) {
+    std::string text;
+    test_ns::string_sink output(&text, 1);
+    test_ns::sharded_feed_handler handler("", 2, &output,
+            test_ns::err_callback_t());
+    handler.process_command("ORDER ADD,1,S1,Buy,10,72.82");
+    handler.process_command("PRINT,S1");
+    ASSERT_TRUE(text.empty());
+    handler.finish();
+    ASSERT_FALSE(text.empty());
+    std::string first = text;
+    handler.process_command("PRINT,S1");
+    handler.finish();
+    ASSERT_EQ(text, first + first);
+}
@@ -0,0 +1,112 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace test_ns {
+
+/*
+ * Bounded lock-free queue between one producer thread and one consumer
+ * thread. Slots are constructed once and reused: the producer fills the
+ * slot returned by begin_push() and publishes it with end_push(), the
+ * consumer reads the slot returned by begin_pop() and gives it back with
+ * end_pop(). A slot holding a vector keeps its capacity from one use to
+ * the next.
+ *
+ * The index each side writes is padded to a cache line of its own, and
+ * each side keeps a copy of the other index which it reloads only when
+ * the ring looks full or empty.
+ */
+template <typename value_t>
+class spsc_ring {
+ public:
+    /*
+     * capacity is rounded up to a power of two.
+     */
+    explicit spsc_ring(size_t capacity)
+        : slots(round_up(capacity)), mask(slots.size() - 1), closed(false),
+          head(0), cached_tail(0), tail(0), cached_head(0) {}
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    size_t capacity() const { return slots.size(); }
+
+    /*
+     * The slot to fill, nullptr if the ring is full.
+     */
+    value_t* begin_push() {
+        size_t position = tail.load(std::memory_order_relaxed);
+        if (position - cached_head == slots.size()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (position - cached_head == slots.size()) {
+                return nullptr;
+            }
+        }
+        return &slots[position & mask];
+    }
+    void end_push() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+    }
+    /*
+     * No slot follows. Called by the producer after its last end_push().
+     */
+    void close() {
+        closed.store(true, std::memory_order_release);
+    }
+
+    /*
+     * The oldest slot pushed, nullptr if the ring is empty.
+     */
+    value_t* begin_pop() {
+        size_t position = head.load(std::memory_order_relaxed);
+        if (position == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (position == cached_tail) {
+                return nullptr;
+            }
+        }
+        return &slots[position & mask];
+    }
+    void end_pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+    }
+    /*
+     * Whether the ring is empty for good: closed and every slot popped.
+     */
+    bool is_drained() {
+        return closed.load(std::memory_order_acquire) &&
+                begin_pop() == nullptr;
+    }
+
+ private:
+    static const size_t cache_line_size = 64;
+
+    static size_t round_up(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<value_t> slots;
+    size_t mask;
+    std::atomic<bool> closed;
+    char pad1[cache_line_size];
+    // written by the consumer
+    std::atomic<size_t> head;
+    size_t cached_tail;
+    char pad2[cache_line_size];
+    // written by the producer
+    std::atomic<size_t> tail;
+    size_t cached_head;
+    char pad3[cache_line_size];
+};
+
+}  // namespace test_ns
+
+#endif  // SPSC_RING_H
@@ -0,0 +1,95 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "spsc_ring.h"
+
+/*
+ *
+ */
+TEST(SpscRing, Capacity) {
+    test_ns::spsc_ring<int> ring(5);
+    ASSERT_EQ(ring.capacity(), 8);
+    ASSERT_EQ(test_ns::spsc_ring<int>(0).capacity(), 1);
+}
+
+TEST(SpscRing, FullAndEmpty) {
+    test_ns::spsc_ring<int> ring(2);
+    ASSERT_EQ(ring.begin_pop(), nullptr);
+    *ring.begin_push() = 1;
+    ring.end_push();
+    *ring.begin_push() = 2;
+    ring.end_push();
+    ASSERT_EQ(ring.begin_push(), nullptr);
+    ASSERT_EQ(*ring.begin_pop(), 1);
+    ring.end_pop();
+    *ring.begin_push() = 3;
+    ring.end_push();
+    ASSERT_EQ(*ring.begin_pop(), 2);
+    ring.end_pop();
+    ASSERT_EQ(*ring.begin_pop(), 3);
+    ring.end_pop();
+    ASSERT_EQ(ring.begin_pop(), nullptr);
+}
+
+/*
+ * A slot keeps what was left in it.
+ */
+TEST(SpscRing, SlotsAreReused) {
+    test_ns::spsc_ring<std::vector<int>> ring(1);
+    ring.begin_push()->assign(100, 1);
+    ring.end_push();
+    ring.begin_pop()->clear();
+    ring.end_pop();
+    ASSERT_TRUE(ring.begin_push()->empty());
+    ASSERT_GE(ring.begin_push()->capacity(), 100);
+}
+
+TEST(SpscRing, Drained) {
+    test_ns::spsc_ring<int> ring(4);
+    ASSERT_FALSE(ring.is_drained());
+    *ring.begin_push() = 1;
+    ring.end_push();
+    ring.close();
+    ASSERT_FALSE(ring.is_drained());
+    ring.end_pop();
+    ASSERT_TRUE(ring.is_drained());
+}
+
+/*
+ * Values pass from one thread to the other in order.
+ */
+TEST(SpscRing, TwoThreads) {
+    const uint64_t count = 200000;
+    test_ns::spsc_ring<uint64_t> ring(16);
+    std::thread producer([&ring, count]() {
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t* slot;
+            while ((slot = ring.begin_push()) == nullptr) {
+                std::this_thread::yield();
+            }
+            *slot = i;
+            ring.end_push();
+        }
+        ring.close();
+    });
+    uint64_t expected = 0;
+    bool in_order = true;
+    for (;;) {
+        uint64_t* slot = ring.begin_pop();
+        if (slot == nullptr) {
+            if (ring.is_drained()) {
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+        in_order = in_order && *slot == expected;
+        ++expected;
+        ring.end_pop();
+    }
+    producer.join();
+    ASSERT_TRUE(in_order);
+    ASSERT_EQ(expected, count);
+}
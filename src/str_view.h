@@ -0,0 +1,41 @@
+#ifndef STR_VIEW_H
+#define STR_VIEW_H
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace test_ns {
+
+/*
+ * Non-owning reference to a range of characters, e.g. a line inside
+ * a memory mapped file. The referenced memory must outlive the view.
+ */
+struct str_view_t {
+    const char* data;
+    size_t size;
+
+    str_view_t() : data(""), size(0) {}
+    str_view_t(const char* d, size_t n) : data(d), size(n) {}
+    str_view_t(const char* s) : data(s), size(std::strlen(s)) {}  // NOLINT
+    str_view_t(const std::string& s)  // NOLINT
+        : data(s.data()), size(s.size()) {}
+
+    bool empty() const { return size == 0; }
+    const char* begin() const { return data; }
+    const char* end() const { return data + size; }
+    char operator[](size_t i) const { return data[i]; }
+    std::string to_string() const { return std::string(data, size); }
+};
+
+inline bool operator==(const str_view_t& a, const str_view_t& b) {
+    return a.size == b.size && std::memcmp(a.data, b.data, a.size) == 0;
+}
+
+inline bool operator!=(const str_view_t& a, const str_view_t& b) {
+    return !(a == b);
+}
+
+}  // namespace test_ns
+
+#endif  // STR_VIEW_H
@@ -0,0 +1,76 @@
+#include "symbol_table.h"
+
+/*
+ *
+ */
+test_ns::
+symbol_table::symbol_table() : slots(16, no_symbol), mask(15) {
+}
+
+/*
+ * FNV-1a, symbols are a few characters long.
+ */
+size_t test_ns::
+symbol_table::hash(const str_view_t& symbol) {
+    uint64_t h = UINT64_C(14695981039346656037);
+    for (char c : symbol) {
+        h ^= static_cast<unsigned char>(c);
+        h *= UINT64_C(1099511628211);
+    }
+    return static_cast<size_t>(h ^ (h >> 32));
+}
+
+/*
+ * The slot of symbol, or the empty slot where it would go.
+ */
+size_t test_ns::
+symbol_table::find_slot(const str_view_t& symbol, size_t h) const {
+    size_t i = h & mask;
+    while (slots[i] != no_symbol && str_view_t(names[slots[i]]) != symbol) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/*
+ *
+ */
+test_ns::symbol_id_t test_ns::
+symbol_table::find(const str_view_t& symbol) const {
+    return slots[find_slot(symbol, hash(symbol))];
+}
+
+/*
+ *
+ */
+test_ns::symbol_id_t test_ns::
+symbol_table::intern(const str_view_t& symbol) {
+    size_t h = hash(symbol);
+    size_t i = find_slot(symbol, h);
+    if (slots[i] != no_symbol) {
+        return slots[i];
+    }
+    if ((names.size() + 1) * 2 > slots.size()) {
+        grow();
+        i = find_slot(symbol, h);
+    }
+    symbol_id_t id = static_cast<symbol_id_t>(names.size());
+    names.push_back(symbol.to_string());
+    slots[i] = id;
+    return id;
+}
+
+/*
+ * Doubles the slots, the table is kept at most half full.
+ */
+void test_ns::
+symbol_table::grow() {
+    std::vector<symbol_id_t> old_slots(slots.size() * 2, no_symbol);
+    old_slots.swap(slots);
+    mask = slots.size() - 1;
+    for (symbol_id_t id : old_slots) {
+        if (id != no_symbol) {
+            slots[find_slot(names[id], hash(names[id]))] = id;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "str_view.h"
+
+namespace test_ns {
+
+/*
+ * Dense id of an interned symbol, ids are given out from 0 up.
+ */
+using symbol_id_t = uint32_t;
+const symbol_id_t no_symbol = UINT32_MAX;
+
+/*
+ * Interns symbols into dense ids, so that a symbol is hashed once per
+ * command and containers are keyed by an integer. Symbols are never
+ * removed. Names do not move once interned.
+ */
+class symbol_table {
+ public:
+    symbol_table();
+    symbol_id_t intern(const str_view_t& symbol);
+    symbol_id_t find(const str_view_t& symbol) const;
+    const std::string& get_name(symbol_id_t id) const {
+        return names[id];
+    }
+    size_t size() const {
+        return names.size();
+    }
+
+    /*
+     * Orders ids by the names of their symbols.
+     */
+    struct name_less_t {
+        const symbol_table* table;
+        bool operator()(symbol_id_t a, symbol_id_t b) const {
+            return table->names[a] < table->names[b];
+        }
+    };
+
+ private:
+    std::deque<std::string> names;
+    std::vector<symbol_id_t> slots;
+    size_t mask;
+    static size_t hash(const str_view_t& symbol);
+    size_t find_slot(const str_view_t& symbol, size_t hash) const;
+    void grow();
+};
+
+}  // namespace test_ns
+
+#endif  // SYMBOL_TABLE_H
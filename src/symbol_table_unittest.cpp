@@ -0,0 +1,50 @@
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "symbol_table.h"
+
+/*
+ *
+ */
+TEST(SymbolTable, Intern) {
+    test_ns::symbol_table symbols;
+    ASSERT_EQ(symbols.size(), 0);
+    ASSERT_EQ(symbols.find("S1"), test_ns::no_symbol);
+    ASSERT_EQ(symbols.intern("S1"), 0);
+    ASSERT_EQ(symbols.intern("S2"), 1);
+    ASSERT_EQ(symbols.intern(std::string("S1")), 0);
+    ASSERT_EQ(symbols.find("S2"), 1);
+    ASSERT_EQ(symbols.find("S"), test_ns::no_symbol);
+    ASSERT_EQ(symbols.get_name(0), "S1");
+    ASSERT_EQ(symbols.get_name(1), "S2");
+    ASSERT_EQ(symbols.size(), 2);
+}
+
+TEST(SymbolTable, Grow) {
+    test_ns::symbol_table symbols;
+    const char* first = nullptr;
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(symbols.intern("SYM" + std::to_string(i)), i);
+        if (i == 0) {
+            first = symbols.get_name(0).data();
+        }
+    }
+    // names do not move while the table grows
+    ASSERT_EQ(symbols.get_name(0).data(), first);
+    for (int i = 0; i < 10000; ++i) {
+        ASSERT_EQ(symbols.find("SYM" + std::to_string(i)), i);
+        ASSERT_EQ(symbols.get_name(i), "SYM" + std::to_string(i));
+    }
+    ASSERT_EQ(symbols.find("SYM10000"), test_ns::no_symbol);
+}
+
+TEST(SymbolTable, NameLess) {
+    test_ns::symbol_table symbols;
+    std::vector<test_ns::symbol_id_t> ids = {symbols.intern("C"),
+            symbols.intern("A"), symbols.intern("B")};
+    std::sort(ids.begin(), ids.end(),
+            test_ns::symbol_table::name_less_t{&symbols});
+    ASSERT_EQ(ids, (std::vector<test_ns::symbol_id_t>{1, 2, 0}));
+}
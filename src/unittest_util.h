@@ -0,0 +1,135 @@
+#ifndef UNITTEST_UTIL_H
+#define UNITTEST_UTIL_H
+
+#include <unistd.h>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "feed_handler.h"
+#include "line_reader.h"
+
+/*
+ * Helpers shared by the unit tests: temporary files, random feeds and a
+ * replay line by line to compare the other replays with.
+ */
+namespace test_ns {
+namespace unittest {
+
+/*
+ * A file in /tmp holding content, removed with the object.
+ */
+struct temp_file_t {
+    std::string name;
+
+    explicit temp_file_t(const std::string& content = std::string()) {
+        char templ[] = "/tmp/md_replay_unittest.XXXXXX";
+        int fd = mkstemp(templ);
+        name = templ;
+        if (fd >= 0) {
+            ssize_t res = write(fd, content.data(), content.size());
+            (void)res;
+            close(fd);
+        }
+    }
+    ~temp_file_t() {
+        unlink(name.c_str());
+    }
+    temp_file_t(const temp_file_t&) = delete;
+    temp_file_t& operator=(const temp_file_t&) = delete;
+};
+
+/*
+ * Output and error lines of a replay, errors as "<line>: <error>".
+ */
+struct replay_result_t {
+    std::string output;
+    std::vector<std::string> errors;
+};
+
+inline err_callback_t make_err_callback(replay_result_t* result) {
+    return [result](const std::string& line, const std::string& err) {
+        result->errors.push_back(line + ": " + err);
+    };
+}
+
+/*
+ * Orders, prints and subscriptions of a few symbols, with duplicate and
+ * unknown order ids and lines which are not valid commands.
+ */
+inline std::vector<std::string> random_lines(unsigned seed, size_t size) {
+    std::mt19937 random(seed);
+    const char* sides[] = {"Buy", "Sell"};
+    const char* bad_lines[] = {"", "ORDER", "ORDER ADD,1,S1,Buy,10",
+        "ORDER MODIFY,x,10,1.5", "PRINT", "SUBSCRIBE VWAP,S1,0",
+        "UNKNOWN,S1", "ORDER ADD,2,S1,Hold,10,1.5"};
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < size; ++i) {
+        std::string symbol = "S" + std::to_string(random() % 6);
+        std::string id = std::to_string(random() % 300);
+        std::string quantity = std::to_string(1 + random() % 50);
+        std::string price = std::to_string(90 + random() % 20) + "." +
+                std::to_string(random() % 100);
+        unsigned kind = random() % 100;
+        if (kind < 45) {
+            lines.push_back("ORDER ADD," + id + "," + symbol + "," +
+                    sides[random() % 2] + "," + quantity + "," + price);
+        } else if (kind < 60) {
+            lines.push_back("ORDER MODIFY," + id + "," + quantity + "," +
+                    price);
+        } else if (kind < 80) {
+            lines.push_back("ORDER CANCEL," + id);
+        } else if (kind < 84) {
+            lines.push_back("SUBSCRIBE BBO," + symbol);
+        } else if (kind < 86) {
+            lines.push_back("UNSUBSCRIBE BBO," + symbol);
+        } else if (kind < 90) {
+            lines.push_back("SUBSCRIBE VWAP," + symbol + "," + quantity);
+        } else if (kind < 92) {
+            lines.push_back("UNSUBSCRIBE VWAP," + symbol + "," + quantity);
+        } else if (kind < 94) {
+            lines.push_back("PRINT," + symbol);
+        } else if (kind < 96) {
+            lines.push_back("PRINT_FULL," + symbol);
+        } else {
+            lines.push_back(bad_lines[random() % 8]);
+        }
+    }
+    return lines;
+}
+
+/*
+ * random_lines() as the text of a feed, each line ended by a newline.
+ */
+inline std::string random_feed(unsigned seed, size_t size) {
+    std::string feed;
+    for (auto const & line : random_lines(seed, size)) {
+        feed += line;
+        feed += '\n';
+    }
+    return feed;
+}
+
+/*
+ * A replay of file line by line with process_command().
+ */
+inline replay_result_t replay(const std::string& file,
+        const std::string& symbol) {
+    replay_result_t result;
+    string_sink output(&result.output);
+    feed_handler handler(symbol, &output, make_err_callback(&result));
+    line_reader reader;
+    reader.open(file);
+    str_view_t line;
+    while (reader.next_line(&line)) {
+        handler.process_command(line);
+    }
+    output.flush();
+    return result;
+}
+
+}  // namespace unittest
+}  // namespace test_ns
+
+#endif  // UNITTEST_UTIL_H